@@ -1,5 +1,9 @@
 #include "tools.h"
 #include "heap.h" // il faut aussi votre code pour heap.c
+#include "conn.h"
+#include "tmap.h"
+#include "quadtree.h"
+#include "terrain.h"
 
 
 // Une fonction de type "heuristic" est une fonction h() qui renvoie
@@ -27,6 +31,11 @@ double halpha(position s, position t, grid *G) {
   return alpha*hvo(s,t,G);
 }
 
+// Index de connexité optionnel de la grille (cf. conn.h). S'il est
+// défini, les recherches vérifient d'abord que la destination est dans
+// la même composante que la source.
+static conn *connex = NULL;
+
 // Structure "noeud" pour le tas min Q.
 typedef struct node {
   position pos;        // position (.x,.y) d'un noeud u
@@ -94,8 +103,19 @@ double weight[]={
 // somme des degrés des sommets dans la grille. Pour visualiser un
 // noeud de coordonnées (i,j) qui passe dans le tas Q vous pourrez
 // mettre G.mark[i][j] = M_FRONT au moment où vous l'ajoutez.
+//
+// Écrivez les marques avec setMark(G,i,j,m) plutôt que directement:
+// drawGrid() ne redessine alors que les cases modifiées.
 
 void A_star(grid G, heuristic h){
+  PROF_BEGIN("A_star");
+
+  // destination inaccessible détectée en O(1)
+  if(connex && !connSame(connex, G.start, G.end)){
+    printf("Aucun chemin trouvé\n");
+    PROF_END();
+    return;
+  }
 
   // On initialise Q, qui contiendra les sommets à visiter
   heap Q = heap_create(G.X * G.Y * 8, compareNodes);
@@ -109,7 +129,7 @@ void A_star(grid G, heuristic h){
   heap_add(Q, start);
   
   // On marque ce sommet comme étant le sommet en train d'être visité
-  G.mark[start->pos.x][start->pos.y] = M_FRONT;
+  setMark(G, start->pos.x, start->pos.y, M_FRONT);
 
   // Variable qui indique si un chemin a été trouvé
   bool pathFound = false;
@@ -123,21 +143,23 @@ void A_star(grid G, heuristic h){
 
     // Si u = t alors renvoyer le chemin de s à t grâce à la relation parent
     if(u->pos.x == G.end.x && u->pos.y == G.end.y){
+      PROF_BEGIN("A_star/chemin");
       // On marque le sommet courant comme faisant partie du chemin
-      G.mark[u->pos.x][u->pos.y] = M_PATH;
+      setMark(G, u->pos.x, u->pos.y, M_PATH);
       drawGrid(G);
 
       // On va parcourir tous les parents, et on va les marquer comme faisant
       // partie du chemin
       node parent = u->parent;
       while(parent != NULL){
-        G.mark[parent->pos.x][parent->pos.y] = M_PATH;
+        setMark(G, parent->pos.x, parent->pos.y, M_PATH);
         drawGrid(G);
         parent = parent->parent; 
       }
 
       // On pense bien à indiquer qu'un chemin a été trouvé pour terminer la boucle
       pathFound = true;
+      PROF_END();
     }
 
     if(pathFound) continue;
@@ -145,43 +167,47 @@ void A_star(grid G, heuristic h){
     // Si u appartient à P, on continue la boucle, sinon on l’ajouter à P
     if(G.mark[u->pos.x][u->pos.y] != M_USED){
       // M_USED "modélise" l'appartenance à P. P étant l'ensemble des sommets visités
-      G.mark[u->pos.x][u->pos.y] = M_USED;
+      setMark(G, u->pos.x, u->pos.y, M_USED);
       drawGrid(G);
     }
 
     // Pour tout voisin v de u tel que :
     // v n'appartient pas à P
     // v n'est pas un mur
-    for(int i = u->pos.x - 1; i <= u->pos.x + 1; i ++){
-      for(int j = u->pos.y - 1; j <= u->pos.y + 1; j ++){
-
-        if(G.mark[i][j] == M_USED) continue; // test appartenance à P
-        if(G.value[i][j] == V_WALL) continue; // test v est un mur
-
-        // On calcule le cout : c'est le cout du noeud précèdent, plus le cout
-        // du noeud courant
-
-        double c = u->cost + weight[G.value[i][j]];
-
-        // On peut créer le noeud v
-        node v = malloc(sizeof(*v));
-        v->parent = u;
-        v->pos.x = i;
-        v->pos.y = j;
-        v->cost = c;
-        v->score = v->cost + h(v->pos, G.end, &G);
-        
-        if(i == u->pos.x || j == u->pos.y){
-          v->score -= 0.00001;
-        }
-        
-        // on ajoute v à Q, et on le marque comme sommet en cours de visite
-        if(G.mark[i][j] != M_FRONT)
-        {
-          heap_add(Q, v);
-          G.mark[i][j] = M_FRONT;
-          exploredNodes++;
-        }
+    // (écarts précalculés dans G.nbr[], le bord sentinelle évite de
+    // tester les bornes)
+    uint8_t *mu = &G.mark[u->pos.x][u->pos.y];
+    uint8_t *vu = &G.value[u->pos.x][u->pos.y];
+    for(int k = 0; k < 8; k ++){
+      if(mu[G.nbr[k]] == M_USED) continue; // test appartenance à P
+      if(vu[G.nbr[k]] == V_WALL) continue; // test v est un mur
+
+      int i = u->pos.x + nbr_dx[k];
+      int j = u->pos.y + nbr_dy[k];
+
+      // On calcule le cout : c'est le cout du noeud précèdent, plus le cout
+      // du noeud courant
+
+      double c = u->cost + weight[vu[G.nbr[k]]];
+
+      // On peut créer le noeud v
+      node v = malloc(sizeof(*v));
+      v->parent = u;
+      v->pos.x = i;
+      v->pos.y = j;
+      v->cost = c;
+      v->score = v->cost + h(v->pos, G.end, &G);
+      
+      if(i == u->pos.x || j == u->pos.y){
+        v->score -= 0.00001;
+      }
+      
+      // on ajoute v à Q, et on le marque comme sommet en cours de visite
+      if(mu[G.nbr[k]] != M_FRONT)
+      {
+        heap_add(Q, v);
+        setMark(G, i, j, M_FRONT);
+        exploredNodes++;
       }
     }
   }
@@ -197,37 +223,58 @@ void A_star(grid G, heuristic h){
 
   // Dans tous les cas on libère la mémoire
   heap_destroy(Q);
+  PROF_END();
 }
 
 void A_star2(grid G, heuristic h){
   // TODO
 }
 
+#include "a_star_coop.c"
+#include "a_star_conn.c"
+#include "a_star_multi.c"
+#include "a_star_tmap.c"
+#include "a_star_qtree.c"
+
 int main(int argc, char *argv[]){
 
   unsigned seed=time(NULL)%1000;
   printf("seed: %u\n",seed); // pour rejouer la même grille au cas où
-  srandom(seed);
+  rng R; // générateur aléatoire de toutes les grilles (cf. rng.h)
+  rngSeed(&R, seed);
+  PROF_EXIT("a_star.json"); // avec make PROF=1, cf. prof.h
+
+  // bancs d'essai sans affichage
+  if (argc > 1 && !strcmp(argv[1], "coop")) return coopBench(argc, argv, &R);
+  if (argc > 1 && !strcmp(argv[1], "tmap")) return tmapBench(argc, argv, &R);
+  if (argc > 1 && !strcmp(argv[1], "qtree")) return qtreeBench(argc, argv, &R);
+  if (argc > 1 && !strcmp(argv[1], "conn")) return connBench(argc, argv, &R);
+  if (argc > 1 && !strcmp(argv[1], "multi")) return multiBench(argc, argv, &R);
 
 
   // tester les différentes grilles et positions s->t ...
 
-  grid G = initGridPoints(80,60,V_FREE,1); // grille uniforme
+  grid G = initGridPoints(80,60,V_FREE,1,&R); // grille uniforme
   //position s={G.X/4,G.Y/2}, t={G.X/2,G.Y/4}; G.start=s; G.end=t; // s->t
-  //grid G = initGridPoints(64,48,V_WALL, 0.2); // grille de points aléatoires
-  //grid G = initGridLaby(15, 15, 5); // labyrinthe aléatoire
-  //grid G = initGridLaby(50, 50, 5); // labyrinthe aléatoire
+  //grid G = initGridPoints(64,48,V_WALL, 0.2, &R); // grille de points aléatoires
+  //grid G = initGridLaby(15, 15, 5, &R); // labyrinthe aléatoire
+  //grid G = initGridLaby(50, 50, 5, &R); // labyrinthe aléatoire
   // position tmp; SWAP(G.start,G.end,tmp); // t->s (inverse source et cible)
   //grid G = initGridFile("m.txt"); // grille à partir d'un fichier
  
   // pour ajouter à G des "régions" de différent types:
 
-  // addRandomBlob(G, V_WALL,   (G.X+G.Y)/20);
-  // addRandomBlob(G, V_SAND,   (G.X+G.Y)/15);
-  // addRandomBlob(G, V_WATER,  (G.X+G.Y)/3);
-  // addRandomBlob(G, V_MUD,    (G.X+G.Y)/3);
-  // addRandomBlob(G, V_GRASS,  (G.X+G.Y)/15);
-  // addRandomBlob(G, V_TUNNEL, (G.X+G.Y)/4);
+  // addRandomBlob(G, V_WALL,   (G.X+G.Y)/20, &R);
+  // addRandomBlob(G, V_SAND,   (G.X+G.Y)/15, &R);
+  // addRandomBlob(G, V_WATER,  (G.X+G.Y)/3, &R);
+  // addRandomBlob(G, V_MUD,    (G.X+G.Y)/3, &R);
+  // addRandomBlob(G, V_GRASS,  (G.X+G.Y)/15, &R);
+  // addRandomBlob(G, V_TUNNEL, (G.X+G.Y)/4, &R);
+
+  // index de connexité, à construire une fois la grille terminée (puis
+  // à tenir à jour avec connAddWall() si l'on ajoute des murs)
+  conn C = connCreate(G);
+  connex = &C;
 
   // constantes à initialiser avant init_SDL_OpenGL()
   scale = fmin((double)width/G.X,(double)height/G.Y); // zoom courant
@@ -240,12 +287,18 @@ int main(int argc, char *argv[]){
   alpha=3;
   A_star(G, halpha); // heuristique: h0, hvo, alpha*hvo
 
+  // plus proche de plusieurs destinations en une seule recherche:
+  // position T[]={{G.X/4,G.Y/4},{3*G.X/4,G.Y/4},{G.X/2,3*G.Y/4}};
+  // A_star_multi(G, T, 3, hvo, NULL, NULL);
+
   update = true; // force l'affichage de chaque dessin
   while (running) { // affiche le résultat et attend
     drawGrid(G); // dessine la grille
     handleEvent(true); // attend un évènement
   }
 
+  connex = NULL;
+  connFree(C);
   freeGrid(G);
   cleaning_SDL_OpenGL();
   return 0;
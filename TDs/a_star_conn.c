@@ -0,0 +1,75 @@
+//
+//  A* - VÉRIFICATION DE L'INDEX DE CONNEXITÉ
+//
+// -> fichier inclus dans a_star.c après a_star_coop.c (utilise coopClock)
+//
+// connAddWall() met l'index à jour localement. On vérifie ici qu'après
+// des insertions aléatoires de murs il décrit les mêmes composantes
+// qu'un index reconstruit par connCreate(). Les étiquettes ne sont pas
+// les mêmes (les scissions prennent des étiquettes nouvelles): on
+// vérifie qu'elles se correspondent une à une.
+
+// Nombre de cases dont l'étiquette de A ne correspond pas à celle de B
+// par une bijection entre les étiquettes des deux index.
+static int connDiff(conn *A, conn *B) {
+  const int n = A->X * A->Y;
+  int *ab = malloc(A->next * sizeof(*ab)); // étiquette de A -> de B
+  int *ba = malloc(B->next * sizeof(*ba)); // étiquette de B -> de A
+  for (int l = 0; l < A->next; l++) ab[l] = -1;
+  for (int l = 0; l < B->next; l++) ba[l] = -1;
+  int bad = 0;
+  for (int c = 0; c < n; c++) {
+    const int a = A->label[c], b = B->label[c];
+    if (a < 0 || b < 0) {
+      bad += (a != b);
+      continue;
+    }
+    if (ab[a] < 0 && ba[b] < 0) ab[a] = b, ba[b] = a;
+    bad += (ab[a] != b || ba[b] != a);
+  }
+  free(ab);
+  free(ba);
+  return bad;
+}
+
+// Banc d'essai: ./a_star conn [x y p k]. Sur une grille
+// initGridPoints(x,y,V_WALL,p) (512 x 512 et 40% de murs par défaut),
+// ajoute k murs aléatoires (10000 par défaut) avec connAddWall() en
+// comparant l'index à connCreate() tous les k/10 murs, puis affiche les
+// temps des deux méthodes.
+int connBench(int argc, char *argv[], rng *R) {
+  const int x = (argc > 2 && atoi(argv[2]) > 2) ? atoi(argv[2]) : 512;
+  const int y = (argc > 3 && atoi(argv[3]) > 2) ? atoi(argv[3]) : 512;
+  const double p = (argc > 4) ? atof(argv[4]) : 0.4;
+  const int k = (argc > 5 && atoi(argv[5]) > 0) ? atoi(argv[5]) : 10000;
+  grid G = initGridPoints(x, y, V_WALL, p, R);
+
+  double t0 = coopClock();
+  conn C = connCreate(G);
+  double tc = coopClock() - t0, ti = 0;
+
+  int walls = 0, bad = 0, r = (k + 9) / 10;
+  for (int w = 0; w < k; w += r) {
+    t0 = coopClock();
+    for (int i = w; i < w + r && i < k; i++) {
+      const int a = rngBelow(R, G.X), b = rngBelow(R, G.Y);
+      if (G.value[a][b] == V_WALL) continue;
+      connAddWall(&C, G, a, b);
+      walls++;
+    }
+    ti += coopClock() - t0;
+    conn F = connCreate(G);
+    bad += connDiff(&C, &F);
+    connFree(F);
+  }
+
+  printf("grille %d x %d, %d murs ajoutés, %d scissions\n", G.X, G.Y, walls,
+         C.next - G.X * G.Y);
+  printf("connCreate: %.3lfms, connAddWall: %.3lfus/mur\n", 1E3 * tc,
+         walls ? 1E6 * ti / walls : 0);
+  printf("cases mal étiquetées: %d\n", bad);
+
+  connFree(C);
+  freeGrid(G);
+  return bad != 0;
+}
@@ -0,0 +1,350 @@
+//
+//  A* - PLANIFICATION COOPÉRATIVE MULTI-AGENTS
+//
+// -> fichier inclus dans a_star.c (utilise weight[], heuristic et le tas)
+//
+// Les agents sont planifiés un par un dans l'ordre de priorité (leur
+// indice). Chaque agent fait un A* dans l'espace-temps, c'est-à-dire
+// sur les états (case,t), en évitant les réservations (case,t) des
+// agents déjà planifiés, puis réserve son propre chemin. L'action
+// "attendre" (rester sur place) est autorisée.
+//
+// Fenêtre: au-delà de l'horizon W les réservations ne sont plus
+// consultées et le temps est "gelé" à W, la recherche redevient alors
+// un A* classique. Le nombre d'états est donc borné par X*Y*(W+1), et
+// il suffit de replanifier toutes les W/2 étapes (par exemple) pour
+// garder des chemins sans collision à moindre coût.
+
+#include <stdint.h>
+
+
+// Table de hachage (adressage ouvert, sondage linéaire) de clés 64
+// bits vers des int. Une entrée est valide ssi son estampille gen[]
+// vaut la génération courante cur, ce qui permet de vider la table en
+// O(1) en incrémentant simplement cur.
+typedef struct {
+  uint64_t *key;
+  int *val;
+  unsigned *gen;
+  unsigned cur;  // génération courante (>0)
+  size_t cap, n; // capacité (puissance de 2) et nombre d'entrées
+} sthash;
+
+static inline size_t sth_slot(uint64_t k, size_t cap) {
+  return (size_t)((k * 0x9E3779B97F4A7C15ULL) >> 17) & (cap - 1);
+}
+
+static void sth_init(sthash *H, size_t cap) {
+  size_t c = 16;
+  while (c < cap) c <<= 1;
+  H->cap = c, H->n = 0, H->cur = 1;
+  H->key = malloc(c * sizeof(*H->key));
+  H->val = malloc(c * sizeof(*H->val));
+  H->gen = calloc(c, sizeof(*H->gen));
+}
+
+static void sth_free(sthash *H) {
+  free(H->key);
+  free(H->val);
+  free(H->gen);
+}
+
+// Vide la table (O(1) sauf lors du débordement de la génération).
+static void sth_clear(sthash *H) {
+  H->n = 0;
+  if (++H->cur == 0) {
+    memset(H->gen, 0, H->cap * sizeof(*H->gen));
+    H->cur = 1;
+  }
+}
+
+// Renvoie un pointeur sur la valeur associée à k, NULL si absente.
+static inline int *sth_get(sthash *H, uint64_t k) {
+  for (size_t s = sth_slot(k, H->cap);; s = (s + 1) & (H->cap - 1)) {
+    if (H->gen[s] != H->cur) return NULL;
+    if (H->key[s] == k) return H->val + s;
+  }
+}
+
+static void sth_put(sthash *H, uint64_t k, int v);
+
+// Double la capacité de la table en réinsérant les entrées valides.
+static void sth_grow(sthash *H) {
+  sthash N;
+  sth_init(&N, 2 * H->cap);
+  for (size_t s = 0; s < H->cap; s++)
+    if (H->gen[s] == H->cur) sth_put(&N, H->key[s], H->val[s]);
+  sth_free(H);
+  *H = N;
+}
+
+// Associe v à la clé k (remplace la valeur si k est déjà présente).
+static void sth_put(sthash *H, uint64_t k, int v) {
+  if (2 * (H->n + 1) > H->cap) sth_grow(H);
+  size_t s = sth_slot(k, H->cap);
+  while (H->gen[s] == H->cur && H->key[s] != k) s = (s + 1) & (H->cap - 1);
+  if (H->gen[s] != H->cur) H->n++;
+  H->gen[s] = H->cur, H->key[s] = k, H->val[s] = v;
+}
+
+// Clé d'un état (case,t) de la grille G.
+static inline uint64_t stKey(grid *G, int x, int y, int t) {
+  return ((uint64_t)t << 32) | (uint32_t)(x * G->Y + y);
+}
+
+
+// Noeud de l'espace-temps pour le tas.
+typedef struct stnode {
+  position pos;          // case du noeud
+  int t;                 // instant, gelé à W au-delà de l'horizon
+  double cost;           // coût[u]
+  double score;          // score[u] = coût[u] + h(u,cible)
+  struct stnode *parent; // NULL pour le départ
+} *stnode;
+
+// À score égal, le noeud le plus profond (coût le plus grand) passe en
+// premier: avec hvo les égalités sont très nombreuses sur une grille.
+static int compareStNodes(const void *x, const void *y) {
+  double const a = ((stnode)x)->score;
+  double const b = ((stnode)y)->score;
+  if (a != b) return (a > b) - (a < b);
+  return (((stnode)x)->cost < ((stnode)y)->cost) -
+         (((stnode)x)->cost > ((stnode)y)->cost);
+}
+
+// Réserve de noeuds allouée par blocs (les noeuds ne bougent jamais en
+// mémoire, contrairement à un realloc()). Vidée entre deux agents.
+#define STBLOCK 4096
+typedef struct {
+  stnode *block; // block[b] = b-ième bloc de STBLOCK noeuds
+  int nb, nmax;  // nombre de blocs utilisés et alloués
+  int used;      // nombre de noeuds utilisés dans le dernier bloc
+} stpool;
+
+static stnode stNew(stpool *M) {
+  if (M->nb == 0 || M->used == STBLOCK) {
+    if (M->nb == M->nmax) {
+      int m = M->nmax ? 2 * M->nmax : 16;
+      M->block = realloc(M->block, m * sizeof(*M->block));
+      for (int b = M->nmax; b < m; b++) M->block[b] = NULL;
+      M->nmax = m;
+    }
+    if (M->block[M->nb] == NULL) // les blocs sont conservés d'un agent à l'autre
+      M->block[M->nb] = malloc(STBLOCK * sizeof(struct stnode));
+    M->nb++;
+    M->used = 0;
+  }
+  return &M->block[M->nb - 1][M->used++];
+}
+
+// Ajoute o au tas h en doublant sa capacité si nécessaire.
+static void heap_push(heap h, void *o) {
+  if (heap_add(h, o)) {
+    h->nmax *= 2;
+    h->array = realloc(h->array, (h->nmax + 1) * sizeof(void *));
+    heap_add(h, o);
+  }
+}
+
+// Réserve les états (P[t],t) de l'agent a pour t=0..W-1, l'agent
+// restant sur sa destination une fois arrivé.
+static void coopReserve(grid *G, sthash *R, position *P, int L, int W, int a) {
+  for (int t = 0; t < W; t++) {
+    position p = P[(t < L) ? t : L - 1];
+    sth_put(R, stKey(G, p.x, p.y, t), a);
+  }
+}
+
+// Vrai ssi l'agent peut rester sur la case p de l'instant t jusqu'à
+// l'horizon W sans rencontrer une réservation.
+static bool coopCanStay(grid *G, sthash *R, position p, int t, int W) {
+  for (; t < W; t++)
+    if (sth_get(R, stKey(G, p.x, p.y, t))) return false;
+  return true;
+}
+
+// A* dans l'espace-temps pour un agent a allant de s à e. Les
+// réservations des agents précédents sont dans R. Renvoie le chemin
+// (alloué, P[t] = position à l'instant t) et sa longueur dans *L, ou
+// NULL s'il n'y a pas de chemin.
+static position *coopSearch(grid *G, sthash *R, sthash *C, stpool *M, heap Q,
+                            position s, position e, int W, heuristic h,
+                            int *L) {
+  static const int dx[] = {-1, -1, -1, 0, 0, 1, 1, 1, 0};
+  static const int dy[] = {-1, 0, 1, -1, 1, -1, 0, 1, 0}; // 8 = attendre
+  PROF_BEGIN("coopSearch");
+
+  sth_clear(C);
+  M->nb = 0, M->used = STBLOCK; // vide la réserve de noeuds
+  Q->n = 0;                     // vide le tas
+
+  stnode u = stNew(M);
+  u->pos = s, u->t = 0, u->cost = 0, u->parent = NULL;
+  u->score = h(s, e, G);
+  heap_push(Q, u);
+
+  stnode goal = NULL;
+  while (!heap_empty(Q) && running) {
+    u = heap_pop(Q);
+    uint64_t k = stKey(G, u->pos.x, u->pos.y, u->t);
+    if (sth_get(C, k)) continue; // déjà dans P
+    sth_put(C, k, 1);
+
+    if (u->pos.x == e.x && u->pos.y == e.y && coopCanStay(G, R, e, u->t, W)) {
+      goal = u;
+      break;
+    }
+
+    for (int d = 0; d < 9; d++) {
+      if (d == 8 && u->t >= W) break; // attendre au-delà de W est inutile
+      int i = u->pos.x + dx[d], j = u->pos.y + dy[d];
+      if (G->value[i][j] == V_WALL) continue;
+      int t = (u->t < W) ? u->t + 1 : W;
+      if (sth_get(C, stKey(G, i, j, t))) continue;
+      if (t < W) {
+        // conflit de case: (i,j) est réservée à l'instant t
+        if (sth_get(R, stKey(G, i, j, t))) continue;
+        // conflit d'arête: un agent b fait le trajet inverse (i,j)->u
+        int *b = sth_get(R, stKey(G, i, j, u->t));
+        int *c = sth_get(R, stKey(G, u->pos.x, u->pos.y, t));
+        if (b && c && *b == *c) continue;
+      }
+      stnode v = stNew(M);
+      v->pos.x = i, v->pos.y = j, v->t = t, v->parent = u;
+      v->cost = u->cost + weight[(d == 8) ? V_FREE : G->value[i][j]];
+      v->score = v->cost + h(v->pos, e, G);
+      heap_push(Q, v);
+    }
+  }
+
+  PROF_END();
+  if (goal == NULL) return NULL;
+
+  int n = 0;
+  for (u = goal; u; u = u->parent) n++;
+  position *P = malloc(n * sizeof(*P));
+  *L = n;
+  for (u = goal; u; u = u->parent) P[--n] = u->pos;
+  return P;
+}
+
+// Planifie les k agents allant de S[a] à T[a] (a=0..k-1) par ordre de
+// priorité avec une fenêtre de W étapes. En retour P[a] est le chemin
+// de l'agent a (P[a][t] = position à l'instant t) de longueur L[a], ou
+// NULL si aucun chemin n'a été trouvé: l'agent est alors supposé rester
+// sur S[a], case réservée pour les agents suivants. Les chemins sont à
+// libérer par l'appelant. Renvoie le nombre d'agents planifiés.
+int coopAStar(grid G, position *S, position *T, int k, int W, heuristic h,
+              position **P, int *L) {
+  if (W < 1) W = 1;
+  PROF_BEGIN("coopAStar");
+  sthash R, C; // R = réservations (case,t) -> agent, C = états de P
+  sth_init(&R, 2 * (size_t)k * W);
+  sth_init(&C, 1 << 12);
+  stpool M = {NULL, 0, 0, 0};
+  heap Q = heap_create(1 << 12, compareStNodes);
+
+  int planned = 0;
+  for (int a = 0; a < k && running; a++) {
+    P[a] = NULL;
+    if (!connex || connSame(connex, S[a], T[a]))
+      P[a] = coopSearch(&G, &R, &C, &M, Q, S[a], T[a], W, h, L + a);
+    if (P[a] == NULL) {
+      // l'agent reste sur son départ: les suivants doivent l'éviter
+      L[a] = 0;
+      coopReserve(&G, &R, S + a, 1, W, a);
+      continue;
+    }
+    coopReserve(&G, &R, P[a], L[a], W, a);
+    planned++;
+  }
+
+  Q->n = 0; // les noeuds appartiennent à la réserve M
+  heap_destroy(Q);
+  for (int b = 0; b < M.nmax; b++) free(M.block[b]);
+  free(M.block);
+  sth_free(&C);
+  sth_free(&R);
+  PROF_END();
+  return planned;
+}
+
+// Chronomètre numérique (secondes depuis une origine arbitraire).
+static double coopClock(void) {
+  return 1E-9 * profNow();
+}
+
+// Banc d'essai: ./a_star coop [k] [W]. Planifie k agents (1000 par
+// défaut) sur une grille initGridPoints() de 20% de murs dimensionnée
+// pour environ 40 cases libres par agent, puis affiche le débit en
+// agents planifiés par seconde et vérifie l'absence de collision et
+// d'échange de cases dans la fenêtre.
+int coopBench(int argc, char *argv[], rng *R) {
+  const int k = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 1000;
+  const int W = (argc > 3 && atoi(argv[3]) > 0) ? atoi(argv[3]) : 16;
+  const int x = (int)sqrt(50.0 * k) + 3;
+  grid G = initGridPoints(x, x, V_WALL, 0.2, R);
+
+  // départs et destinations deux à deux distincts, tirés parmi les
+  // cases V_FREE
+  terrain Tr = terrainCreate(G);
+  position *S = malloc(k * sizeof(*S)), *T = malloc(k * sizeof(*T));
+  terrainSample(&Tr, V_FREE, k, S, R);
+  terrainSample(&Tr, V_FREE, k, T, R);
+  terrainFree(Tr);
+
+  // index de connexité: les agents sans chemin sont rejetés en O(1)
+  double t0 = coopClock();
+  PROF_BEGIN("connCreate");
+  conn C = connCreate(G);
+  PROF_END();
+  connex = &C;
+  printf("index de connexité: %.3lfs\n", coopClock() - t0);
+
+  position **P = malloc(k * sizeof(*P));
+  int *L = malloc(k * sizeof(*L));
+  t0 = coopClock();
+  int planned = coopAStar(G, S, T, k, W, hvo, P, L);
+  double t1 = coopClock() - t0;
+
+  // vérification dans la fenêtre: aucune case occupée par deux agents
+  // au même instant, et aucun échange de cases entre t et t+1. Un agent
+  // non planifié reste sur son départ.
+  for (int a = 0; a < k; a++)
+    if (P[a] == NULL) L[a] = 1;
+#define COOP_AT(a, t) ((P[a] ? P[a] : S + (a))[((t) < L[a]) ? (t) : L[a] - 1])
+  sthash O; // occupation vérifiée: (case,t) -> agent
+  sth_init(&O, 2 * (size_t)k * W);
+  int collisions = 0, swaps = 0;
+  for (int a = 0; a < k; a++)
+    for (int t = 0; t < W; t++) {
+      position p = COOP_AT(a, t);
+      uint64_t key = stKey(&G, p.x, p.y, t);
+      if (sth_get(&O, key)) collisions++;
+      else sth_put(&O, key, a);
+    }
+  for (int a = 0; a < k; a++)
+    for (int t = 0; t + 1 < W; t++) {
+      position p = COOP_AT(a, t), q = COOP_AT(a, t + 1);
+      if (p.x == q.x && p.y == q.y) continue;
+      int *b = sth_get(&O, stKey(&G, q.x, q.y, t)); // b en q à l'instant t
+      if (b == NULL || *b <= a) continue;           // chaque paire une fois
+      position r = COOP_AT(*b, t + 1);
+      if (r.x == p.x && r.y == p.y) swaps++;
+    }
+#undef COOP_AT
+  sth_free(&O);
+
+  printf("grille %d x %d, %d agents, fenêtre W=%d\n", G.X, G.Y, k, W);
+  printf("agents planifiés: %d/%d\n", planned, k);
+  printf("collisions: %d, échanges: %d\n", collisions, swaps);
+  printf("temps: %.3lfs, débit: %.0lf agents/s\n", t1, planned / t1);
+
+  for (int a = 0; a < k; a++) free(P[a]);
+  free(P), free(L), free(S), free(T);
+  connex = NULL;
+  connFree(C);
+  freeGrid(G);
+  return 0;
+}
+#undef STBLOCK
@@ -0,0 +1,191 @@
+//
+//  A* - DESTINATIONS MULTIPLES
+//
+// -> fichier inclus dans a_star.c après a_star_coop.c (utilise sthash,
+//    stnode et stpool)
+//
+// Au lieu de lancer k fois A_star() (une fois par destination G.end),
+// on lance une seule recherche depuis G.start qui s'arrête dès qu'une
+// des k destinations est extraite du tas. Jusqu'à MULTI_EXACT
+// destinations, l'heuristique est le minimum de h() sur toutes les
+// destinations, ce qui reste admissible si h() l'est. Au-delà, ce
+// minimum coûterait O(k) par noeud: on prend h() vers le point de la
+// boîte englobante des destinations le plus proche de la case, qui est
+// en O(1) et admissible pour les heuristiques fonctions croissantes de
+// |dx| et |dy| (h0, hvo, halpha). Avec h=h0, c'est un simple Dijkstra
+// et on évite tout calcul. Le travail est donc celui d'une seule
+// recherche au lieu de k, moins bien guidée si k>MULTI_EXACT.
+
+#define MULTI_EXACT 8 // au-delà, h() vise la boîte des destinations
+
+// Heuristique "min sur les destinations" de la position p, B[0..1]
+// étant la boîte englobante des destinations.
+static double hmin(position p, position *T, int k, position *B, heuristic h,
+                   grid *G) {
+  if (h == h0) return 0.0;
+  if (k > MULTI_EXACT) {
+    position q;
+    q.x = (p.x < B[0].x) ? B[0].x : (p.x > B[1].x) ? B[1].x : p.x;
+    q.y = (p.y < B[0].y) ? B[0].y : (p.y > B[1].y) ? B[1].y : p.y;
+    return h(p, q, G);
+  }
+  double m = DBL_MAX;
+  for (int a = 0; a < k; a++) m = fmin(m, h(p, T[a], G));
+  return m;
+}
+
+// Cherche un chemin de G.start vers la plus proche des k destinations
+// T[0..k-1]. Comme pour A_star(), les cases visitées sont marquées
+// M_USED / M_FRONT et le chemin trouvé M_PATH. Renvoie l'indice de la
+// destination atteinte, ou -1 s'il n'y en a pas. Si P!=NULL, le chemin
+// (de G.start à la destination) est alloué dans *P et sa longueur est
+// écrite dans *L.
+int A_star_multi(grid G, position *T, int k, heuristic h, position **P, int *L) {
+  PROF_BEGIN("A_star_multi");
+  sthash goal; // case -> indice de la destination
+  sth_init(&goal, 2 * (size_t)k);
+  position B[2] = {{INT_MAX, INT_MAX}, {INT_MIN, INT_MIN}}; // boîte
+  for (int a = k - 1; a >= 0; a--) // en cas de doublon, le plus petit indice
+    if (!connex || connSame(connex, G.start, T[a])) {
+      sth_put(&goal, stKey(&G, T[a].x, T[a].y, 0), a);
+      if (T[a].x < B[0].x) B[0].x = T[a].x;
+      if (T[a].y < B[0].y) B[0].y = T[a].y;
+      if (T[a].x > B[1].x) B[1].x = T[a].x;
+      if (T[a].y > B[1].y) B[1].y = T[a].y;
+    }
+
+  if (goal.n == 0) { // aucune destination accessible (cf. connex)
+    printf("Aucun chemin trouvé\n");
+    sth_free(&goal);
+    PROF_END();
+    return -1;
+  }
+
+  heap Q = heap_create(1 << 12, compareStNodes);
+  stpool M = {NULL, 0, 0, 0};
+
+  stnode u = stNew(&M);
+  u->pos = G.start, u->t = 0, u->cost = 0, u->parent = NULL;
+  u->score = hmin(G.start, T, k, B, h, &G);
+  heap_push(Q, u);
+  setMark(G, u->pos.x, u->pos.y, M_FRONT);
+
+  int reached = -1, exploredNodes = 0;
+  stnode found = NULL;
+
+  while (!heap_empty(Q) && running) {
+    u = heap_pop(Q);
+    if (G.mark[u->pos.x][u->pos.y] == M_USED) continue; // déjà dans P
+
+    int *a = sth_get(&goal, stKey(&G, u->pos.x, u->pos.y, 0));
+    if (a) { // première destination extraite = la plus proche
+      reached = *a;
+      found = u;
+      break;
+    }
+
+    setMark(G, u->pos.x, u->pos.y, M_USED);
+    drawGrid(G);
+
+    uint8_t *mu = &G.mark[u->pos.x][u->pos.y];
+    uint8_t *vu = &G.value[u->pos.x][u->pos.y];
+    for (int d = 0; d < 8; d++) {
+      if (mu[G.nbr[d]] == M_USED) continue;
+      if (vu[G.nbr[d]] == V_WALL) continue;
+      stnode v = stNew(&M);
+      v->pos.x = u->pos.x + nbr_dx[d], v->pos.y = u->pos.y + nbr_dy[d];
+      v->t = 0, v->parent = u;
+      v->cost = u->cost + weight[vu[G.nbr[d]]];
+      v->score = v->cost + hmin(v->pos, T, k, B, h, &G);
+      heap_push(Q, v);
+      setMark(G, v->pos.x, v->pos.y, M_FRONT);
+      exploredNodes++;
+    }
+  }
+
+  if (found) {
+    int n = 0;
+    for (u = found; u; u = u->parent) {
+      setMark(G, u->pos.x, u->pos.y, M_PATH);
+      drawGrid(G);
+      n++;
+    }
+    if (P) {
+      *P = malloc(n * sizeof(**P));
+      *L = n;
+      for (u = found; u; u = u->parent) (*P)[--n] = u->pos;
+    }
+    printf("Destination %d atteinte\n", reached);
+  } else
+    printf("Aucun chemin trouvé\n");
+
+  printf("Explored nodes = %i\n", exploredNodes);
+
+  Q->n = 0; // les noeuds appartiennent à la réserve M
+  heap_destroy(Q);
+  for (int b = 0; b < M.nmax; b++) free(M.block[b]);
+  free(M.block);
+  sth_free(&goal);
+  PROF_END();
+  return reached;
+}
+
+// Coût du chemin P de longueur L (la case de départ ne compte pas).
+static double multiCost(grid G, position *P, int L) {
+  double c = 0;
+  for (int t = 1; t < L; t++) c += weight[G.value[P[t].x][P[t].y]];
+  return c;
+}
+
+// Efface les marques laissées par une recherche.
+static void multiClear(grid G) {
+  for (int i = 0; i < G.X; i++)
+    for (int j = 0; j < G.Y; j++) G.mark[i][j] = M_NULL;
+}
+
+// Banc d'essai: ./a_star multi [k x y p]. Sur une grille
+// initGridPoints(x,y,V_WALL,p) (200 x 200 et 20% de murs par défaut),
+// cherche la plus proche de k destinations aléatoires (32 par défaut)
+// avec A_star_multi() et hvo, puis par k recherches A* séparées (une
+// destination chacune), et vérifie que le coût trouvé est le minimum
+// des k coûts. A_star() n'est pas utilisée pour la vérification: elle
+// ne remet pas dans le tas un voisin déjà dans Q, et n'est donc pas
+// toujours optimale.
+int multiBench(int argc, char *argv[], rng *R) {
+  const int k = (argc > 2 && atoi(argv[2]) > 0) ? atoi(argv[2]) : 32;
+  const int x = (argc > 3 && atoi(argv[3]) > 2) ? atoi(argv[3]) : 200;
+  const int y = (argc > 4 && atoi(argv[4]) > 2) ? atoi(argv[4]) : 200;
+  const double p = (argc > 5) ? atof(argv[5]) : 0.2;
+  grid G = initGridPoints(x, y, V_WALL, p, R);
+  position *T = malloc(k * sizeof(*T)), *P;
+  terrain Tr = terrainCreate(G);
+  const int n = terrainSample(&Tr, V_FREE, k, T, R);
+  terrainFree(Tr);
+
+  int L;
+  double t0 = coopClock(), cm = -1;
+  int a = A_star_multi(G, T, n, hvo, &P, &L);
+  const double tm = coopClock() - t0;
+  if (a >= 0) cm = multiCost(G, P, L), free(P);
+
+  double c1 = -1, t1 = 0; // meilleur coût des recherches séparées
+  for (int b = 0; b < n; b++) {
+    multiClear(G);
+    t0 = coopClock();
+    if (A_star_multi(G, T + b, 1, hvo, &P, &L) >= 0) {
+      const double c = multiCost(G, P, L);
+      if (c1 < 0 || c < c1) c1 = c;
+      free(P);
+    }
+    t1 += coopClock() - t0;
+  }
+
+  printf("grille %d x %d, %d destinations\n", G.X, G.Y, n);
+  printf("A_star_multi: coût %g, %.3lfs\n", cm, tm);
+  printf("%d recherches: coût %g, %.3lfs\n", n, c1, t1);
+  printf("vérification: %s\n", (cm == c1) ? "ok" : "ÉCHEC");
+
+  free(T);
+  freeGrid(G);
+  return cm != c1;
+}
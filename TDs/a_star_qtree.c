@@ -0,0 +1,197 @@
+//
+//  A* - GRILLES EN QUADTREE
+//
+// -> fichier inclus dans a_star.c après a_star_coop.c (utilise sthash,
+//    stnode et stpool)
+//
+// Les sommets du graphe sont les feuilles du quadtree (cf. quadtree.h)
+// et non plus les cases: un bloc homogène de s x s cases est traversé
+// en une seule étape. Chaque noeud retient la case u->pos par laquelle
+// on est entré dans sa feuille u->t. Pour aller de la case p de la
+// feuille A vers la feuille voisine B, on vise la case q de B la plus
+// proche de p, et on suit le chemin "droit puis diagonal" (qtSegment)
+// dont toutes les cases sauf q sont dans A. Son coût est donc exact:
+// (d-1)*weight[A] + weight[B] avec d = max(|dx|,|dy|).
+//
+// Chaque feuille n'étant atteinte que par une seule case d'entrée, le
+// chemin obtenu est valide mais pas forcément optimal.
+
+// Case de la feuille f la plus proche de p.
+static position qtClamp(const qleaf *f, position p) {
+  position q = p;
+  if (q.x < f->x) q.x = f->x;
+  if (q.x > f->x + f->s - 1) q.x = f->x + f->s - 1;
+  if (q.y < f->y) q.y = f->y;
+  if (q.y > f->y + f->s - 1) q.y = f->y + f->s - 1;
+  return q;
+}
+
+// Ajoute à P[n..] les cases du chemin allant de p (exclu) à q (inclus):
+// d'abord en ligne droite selon la plus grande des deux différences,
+// puis en diagonale. Renvoie la nouvelle taille de P.
+static int qtSegment(position p, position q, position *P, int n) {
+  const int dx = abs(q.x - p.x), dy = abs(q.y - p.y);
+  const int sx = (q.x > p.x) - (q.x < p.x), sy = (q.y > p.y) - (q.y < p.y);
+  for (int k = dy; k < dx; k++) p.x += sx, P[n++] = p;
+  for (int k = dx; k < dy; k++) p.y += sy, P[n++] = p;
+  while (p.x != q.x || p.y != q.y) p.x += sx, p.y += sy, P[n++] = p;
+  return n;
+}
+
+static inline int qtDist(position p, position q) {
+  return fmax(abs(q.x - p.x), abs(q.y - p.y));
+}
+
+// A* de s à t sur le quadtree Q. Renvoie le coût du chemin trouvé, ou
+// -1 s'il n'y en a pas. Si P!=NULL, le chemin case par case (de s à t)
+// est alloué dans *P et sa longueur est écrite dans *L.
+double A_star_qtree(qtree *Q, position s, position t, heuristic h,
+                    position **P, int *L) {
+  PROF_BEGIN("A_star_qtree");
+  const int ls = qtLeaf(Q, s.x, s.y), lt = qtLeaf(Q, t.x, t.y);
+  if (ls < 0 || lt < 0 || Q->leaf[ls].v == V_WALL ||
+      Q->leaf[lt].v == V_WALL) {
+    printf("Aucun chemin trouvé\n");
+    PROF_END();
+    return -1;
+  }
+
+  sthash C; // feuilles de P
+  sth_init(&C, 1 << 10);
+  heap H = heap_create(1 << 10, compareStNodes);
+  stpool M = {NULL, 0, 0, 0};
+  int *N = NULL, nmax = 0;
+
+  stnode u = stNew(&M);
+  u->pos = s, u->t = ls, u->cost = 0, u->parent = NULL;
+  if (ls == lt) // même bloc homogène: on va directement en t
+    u->pos = t, u->cost = qtDist(s, t) * weight[Q->leaf[lt].v];
+  u->score = u->cost + h(u->pos, t, NULL);
+  heap_push(H, u);
+
+  stnode found = NULL;
+  int exploredLeaves = 0;
+  while (!heap_empty(H) && running) {
+    u = heap_pop(H);
+    if (u->t == lt) {
+      found = u;
+      break;
+    }
+    if (sth_get(&C, u->t)) continue; // déjà dans P
+    sth_put(&C, u->t, 1);
+    exploredLeaves++;
+
+    const double wu = weight[Q->leaf[u->t].v];
+    const int n = qtNeighbors(Q, u->t, &N, &nmax);
+    for (int k = 0; k < n; k++) {
+      const qleaf *f = Q->leaf + N[k];
+      if (f->v == V_WALL || sth_get(&C, N[k])) continue;
+      stnode v = stNew(&M);
+      v->pos = qtClamp(f, u->pos), v->t = N[k], v->parent = u;
+      v->cost = u->cost + (qtDist(u->pos, v->pos) - 1) * wu + weight[f->v];
+      if (N[k] == lt) // dernier bloc: on va jusqu'à t
+        v->cost += qtDist(v->pos, t) * weight[f->v], v->pos = t;
+      v->score = v->cost + h(v->pos, t, NULL);
+      heap_push(H, v);
+    }
+  }
+
+  double cost = -1;
+  if (found) {
+    cost = found->cost;
+    if (P) {
+      // noeuds du chemin S[0..m-1], S[0] étant le départ
+      int m = 0;
+      for (u = found; u; u = u->parent) m++;
+      stnode *S = malloc(m * sizeof(*S));
+      int k = m;
+      for (u = found; u; u = u->parent) S[--k] = u;
+      // on passe par s, puis par la case d'entrée q de chaque feuille;
+      // seule la dernière a une case u->pos (=t) différente de q
+      int n = 1 + qtDist(s, S[0]->pos);
+      for (k = 1; k < m; k++) {
+        position q = qtClamp(Q->leaf + S[k]->t, S[k - 1]->pos);
+        n += qtDist(S[k - 1]->pos, q) + qtDist(q, S[k]->pos);
+      }
+      *P = malloc(n * sizeof(**P));
+      (*P)[0] = s;
+      n = qtSegment(s, S[0]->pos, *P, 1);
+      for (k = 1; k < m; k++) {
+        position q = qtClamp(Q->leaf + S[k]->t, S[k - 1]->pos);
+        n = qtSegment(S[k - 1]->pos, q, *P, n);
+        n = qtSegment(q, S[k]->pos, *P, n);
+      }
+      *L = n;
+      free(S);
+    }
+    printf("Chemin trouvé\n");
+  } else
+    printf("Aucun chemin trouvé\n");
+  printf("Explored leaves = %i\n", exploredLeaves);
+
+  H->n = 0; // les noeuds appartiennent à la réserve M
+  heap_destroy(H);
+  for (int b = 0; b < M.nmax; b++) free(M.block[b]);
+  free(M.block);
+  free(N);
+  sth_free(&C);
+  PROF_END();
+  return cost;
+}
+
+static int tmapCell(const void *M, int i, int j) {
+  return tmapValue(M, i, j);
+}
+
+// Compare la taille du quadtree à celle de la grille, puis cherche un
+// chemin et vérifie qu'il est valide:
+//
+//  ./a_star qtree [x y p]   -> initGridPoints(x,y,V_WALL,p)
+//  ./a_star qtree file.tg   -> grille tuilée (cf. tmap.h)
+//
+int qtreeBench(int argc, char *argv[], rng *R) {
+  tmap *T = NULL;
+  grid G = {0};
+  qtree Q;
+  position s, t;
+  double t0 = coopClock();
+  if (argc == 3) {
+    if ((T = tmapOpen(argv[2])) == NULL) return 1;
+    Q = qtCreateFrom(T->X, T->Y, tmapCell, T);
+    s = T->start, t = T->end;
+  } else {
+    const int x = (argc > 4) ? atoi(argv[2]) : 4000;
+    const int y = (argc > 4) ? atoi(argv[3]) : 3000;
+    G = initGridPoints(x, y, V_WALL, (argc > 4) ? atof(argv[4]) : 0.0005, R);
+    Q = qtCreate(G);
+    s = G.start, t = G.end;
+  }
+  const double size = Q.nleaf * sizeof(qleaf) + Q.nnode * 4 * sizeof(int);
+  printf("grille %d x %d: %d feuilles, %d noeuds, %.1lf Mo (grille: %.1lf Mo), "
+         "construction: %.3lfs\n", Q.X, Q.Y, Q.nleaf, Q.nnode, size / 1e6,
+         2.0 * (Q.X + 2) * (Q.Y + 2) / 1e6, coopClock() - t0);
+
+  position *P = NULL;
+  int L = 0;
+  t0 = coopClock();
+  double c = A_star_qtree(&Q, s, t, hvo, &P, &L);
+  printf("coût: %g, temps: %.3lfs\n", c, coopClock() - t0);
+
+  if (P) { // chaque pas est un déplacement valide et les coûts concordent
+    double w = 0;
+    bool ok = (P[0].x == s.x && P[0].y == s.y && P[L - 1].x == t.x &&
+               P[L - 1].y == t.y);
+    for (int k = 1; k < L && ok; k++) {
+      const int v = qtValue(&Q, P[k].x, P[k].y);
+      ok = (qtDist(P[k - 1], P[k]) == 1 && v != V_WALL);
+      w += weight[v];
+    }
+    printf("chemin de %d cases %s\n", L, (ok && w == c) ? "valide" : "INVALIDE");
+    free(P);
+  }
+
+  qtFree(Q);
+  if (T) tmapClose(T);
+  else freeGrid(G);
+  return 0;
+}
@@ -0,0 +1,111 @@
+//
+//  A* - GRILLES TUILÉES PROJETÉES EN MÉMOIRE
+//
+// -> fichier inclus dans a_star.c après a_star_coop.c (utilise sthash,
+//    stnode et stpool)
+//
+// La grille n'est accessible qu'au travers de tmapValue(), et aucun
+// tableau de taille X*Y n'est alloué: l'ensemble P est une table de
+// hachage, ce qui permet de chercher dans des cartes de 10^10 cases en
+// ne lisant que les tuiles effectivement visitées.
+
+// A* sur la grille projetée M de M->start à M->end selon l'heuristique
+// h (appelée avec une grille NULL). Renvoie le coût du chemin trouvé,
+// ou -1 s'il n'y en a pas. Si P!=NULL, le chemin est alloué dans *P et
+// sa longueur est écrite dans *L.
+double A_star_tmap(tmap *M, heuristic h, position **P, int *L) {
+  PROF_BEGIN("A_star_tmap");
+  const position s = M->start, e = M->end;
+  sthash C; // cases de P
+  sth_init(&C, 1 << 16);
+  heap Q = heap_create(1 << 12, compareStNodes);
+  stpool pool = {NULL, 0, 0, 0};
+
+  stnode u = stNew(&pool);
+  u->pos = s, u->t = 0, u->cost = 0, u->parent = NULL;
+  u->score = h(s, e, NULL);
+  heap_push(Q, u);
+
+  stnode found = NULL;
+  int exploredNodes = 0;
+  while (!heap_empty(Q) && running) {
+    u = heap_pop(Q);
+    const uint64_t k = (uint64_t)u->pos.x * M->Y + u->pos.y;
+    if (sth_get(&C, k)) continue; // déjà dans P
+    sth_put(&C, k, 1);
+    if (u->pos.x == e.x && u->pos.y == e.y) {
+      found = u;
+      break;
+    }
+    for (int d = 0; d < 8; d++) {
+      const int i = u->pos.x + nbr_dx[d], j = u->pos.y + nbr_dy[d];
+      const int v = tmapValue(M, i, j);
+      if (v == V_WALL) continue;
+      if (sth_get(&C, (uint64_t)i * M->Y + j)) continue;
+      stnode w = stNew(&pool);
+      w->pos.x = i, w->pos.y = j, w->t = 0, w->parent = u;
+      w->cost = u->cost + weight[v];
+      w->score = w->cost + h(w->pos, e, NULL);
+      heap_push(Q, w);
+      exploredNodes++;
+    }
+  }
+
+  double cost = -1;
+  if (found) {
+    cost = found->cost;
+    if (P) {
+      int n = 0;
+      for (u = found; u; u = u->parent) n++;
+      *P = malloc(n * sizeof(**P));
+      *L = n;
+      for (u = found; u; u = u->parent) (*P)[--n] = u->pos;
+    }
+    printf("Chemin trouvé\n");
+  } else
+    printf("Aucun chemin trouvé\n");
+  printf("Explored nodes = %i\n", exploredNodes);
+
+  Q->n = 0; // les noeuds appartiennent à la réserve
+  heap_destroy(Q);
+  for (int b = 0; b < pool.nmax; b++) free(pool.block[b]);
+  free(pool.block);
+  sth_free(&C);
+  PROF_END();
+  return cost;
+}
+
+// Conversion et recherche sur grilles tuilées (tuiles 256x256):
+//
+//  ./a_star tmap file.tg                  -> A* de start à end
+//  ./a_star tmap conv m.txt file.tg       -> depuis un fichier texte
+//  ./a_star tmap laby x y w file.tg       -> depuis initGridLaby(x,y,w)
+//  ./a_star tmap points x y p file.tg     -> depuis initGridPoints(x,y,V_WALL,p)
+//
+int tmapBench(int argc, char *argv[], rng *R) {
+  const int shift = 8;
+  if (argc == 3) {
+    tmap *M = tmapOpen(argv[2]);
+    if (M == NULL) return 1;
+    printf("grille %ld x %ld, (%d,%d) -> (%d,%d)\n", (long)M->X, (long)M->Y,
+           M->start.x, M->start.y, M->end.x, M->end.y);
+    double t0 = coopClock();
+    double c = A_star_tmap(M, hvo, NULL, NULL);
+    printf("coût: %g, temps: %.3lfs\n", c, coopClock() - t0);
+    tmapClose(M);
+    return 0;
+  }
+  if (argc == 5 && !strcmp(argv[2], "conv"))
+    return !tmapConvertText(argv[3], argv[4], shift);
+  if (argc == 7 && (!strcmp(argv[2], "laby") || !strcmp(argv[2], "points"))) {
+    const int x = atoi(argv[3]), y = atoi(argv[4]);
+    grid G = (argv[2][0] == 'l') ? initGridLaby(x, y, atoi(argv[5]), R)
+                                 : initGridPoints(x, y, V_WALL, atof(argv[5]), R);
+    bool ok = tmapWriteGrid(G, argv[6], shift);
+    freeGrid(G);
+    return !ok;
+  }
+  printf("usage: %s tmap [conv m.txt|laby x y w|points x y p] file.tg\n",
+         argv[0]);
+  return 1;
+}
@@ -0,0 +1,214 @@
+#include "conn.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// largeur minimale (en colonnes) d'une bande traitée par un thread
+#define STRIP 64
+
+// Racine de x avec compression de chemin par "halving".
+static inline int findRoot(int *parent, int x) {
+  while (parent[x] != x) {
+    parent[x] = parent[parent[x]];
+    x = parent[x];
+  }
+  return x;
+}
+
+// Fusionne les arbres de x et y. La plus petite racine devient la
+// racine commune, ce qui rend l'étiquetage indépendant du nombre de
+// threads.
+static inline void unite(int *parent, int x, int y) {
+  x = findRoot(parent, x);
+  y = findRoot(parent, y);
+  if (x < y) parent[y] = x;
+  if (y < x) parent[x] = y;
+}
+
+// Étiquette les colonnes [i0,i1[ de G en ne regardant que les voisins
+// déjà parcourus dans la bande: (i-1,j-1), (i-1,j), (i-1,j+1), (i,j-1).
+static void labelStrip(grid *G, int *parent, int i0, int i1) {
+  const int Y = G->Y;
+  for (int i = i0; i < i1; i++)
+    for (int j = 0; j < Y; j++) {
+      const int c = i * Y + j;
+      if (G->value[i][j] == V_WALL) {
+        parent[c] = -1;
+        continue;
+      }
+      parent[c] = c;
+      if (j > 0 && G->value[i][j - 1] != V_WALL) unite(parent, c, c - 1);
+      if (i == i0) continue;
+      for (int d = -1; d <= 1; d++)
+        if (j + d >= 0 && j + d < Y && G->value[i - 1][j + d] != V_WALL)
+          unite(parent, c, c - Y + d);
+    }
+}
+
+conn connCreate(grid G) {
+  conn C;
+  const int n = G.X * G.Y;
+  C.X = G.X, C.Y = G.Y;
+  C.label = malloc(n * sizeof(*C.label));
+  C.queue = malloc(n * sizeof(*C.queue));
+  C.seen = calloc(n, sizeof(*C.seen));
+  C.stamp = 0;
+  C.next = n; // les étiquettes initiales sont des indices de cases
+  int *parent = C.label; // l'union-find est fait directement dans label[]
+
+  int k = 1; // k = nombre de bandes
+#ifdef _OPENMP
+  k = omp_get_max_threads();
+#endif
+  if (k > G.X / STRIP) k = G.X / STRIP;
+  if (k < 1) k = 1;
+
+  // 1. chaque bande est étiquetée indépendamment
+  #pragma omp parallel for schedule(static)
+  for (int s = 0; s < k; s++)
+    labelStrip(&G, parent, s * G.X / k, (s + 1) * G.X / k);
+
+  // 2. recollement des bandes le long de leur première colonne
+  for (int s = 1; s < k; s++) {
+    const int i = s * G.X / k;
+    for (int j = 0; j < G.Y; j++) {
+      if (G.value[i][j] == V_WALL) continue;
+      for (int d = -1; d <= 1; d++)
+        if (j + d >= 0 && j + d < G.Y && G.value[i - 1][j + d] != V_WALL)
+          unite(parent, i * G.Y + j, (i - 1) * G.Y + j + d);
+    }
+  }
+
+  // 3. aplatissement: chaque case reçoit sa racine. Les racines sont
+  // les plus petits indices de leur arbre, donc parent[c]<=c et on peut
+  // remplacer parent[c] par label[parent[c]] déjà calculé si le
+  // parcours se fait par indices croissants. En parallèle, on suit
+  // simplement les pointeurs sans les modifier, puis on écrit.
+  if (k == 1) {
+    for (int c = 0; c < n; c++)
+      if (parent[c] >= 0) parent[c] = parent[parent[c]];
+  } else {
+    int *root = malloc(n * sizeof(*root));
+    #pragma omp parallel for schedule(static)
+    for (int c = 0; c < n; c++) {
+      int r = parent[c];
+      if (r >= 0)
+        while (parent[r] != r) r = parent[r];
+      root[c] = r;
+    }
+    free(C.label);
+    C.label = root;
+  }
+
+  return C;
+}
+
+void connFree(conn C) {
+  free(C.label);
+  free(C.queue);
+  free(C.seen);
+}
+
+// Ré-étiquette avec l'étiquette lab toutes les cases d'étiquette old
+// atteignables depuis la case c.
+static void relabel(conn *C, int c, int old, int lab) {
+  const int Y = C->Y;
+  int *Q = C->queue;
+  int head = 0, tail = 0;
+  C->label[c] = lab;
+  Q[tail++] = c;
+  while (head < tail) {
+    c = Q[head++];
+    const int i = c / Y, j = c % Y;
+    for (int di = -1; di <= 1; di++)
+      for (int dj = -1; dj <= 1; dj++) {
+        const int x = i + di, y = j + dj;
+        if (x < 0 || y < 0 || x >= C->X || y >= Y) continue;
+        const int d = x * Y + y;
+        if (C->label[d] != old) continue;
+        C->label[d] = lab;
+        Q[tail++] = d;
+      }
+  }
+}
+
+void connAddWall(conn *C, grid G, int x, int y) {
+  static const int dx[] = {-1, 0, 1, 1, 1, 0, -1, -1}; // tour de la case
+  static const int dy[] = {-1, -1, -1, 0, 1, 1, 1, 0}; // dans l'ordre
+
+  if (G.value[x][y] == V_WALL) return;
+  const int old = C->label[x * C->Y + y];
+  setValue(G, x, y, V_WALL);
+  C->label[x * C->Y + y] = -1;
+
+  // groupes de voisins libres reliés entre eux sans passer par (x,y):
+  // deux voisins sont reliés ssi ils sont à distance (Lmax) 1.
+  int grp[8], ng = 0;
+  for (int a = 0; a < 8; a++) {
+    const int i = x + dx[a], j = y + dy[a];
+    grp[a] = -1;
+    if (i < 0 || j < 0 || i >= G.X || j >= G.Y || G.value[i][j] == V_WALL)
+      continue;
+    grp[a] = a;
+  }
+  for (int a = 0; a < 8; a++) // union-find sur au plus 8 éléments
+    for (int b = a + 1; b < 8; b++)
+      if (grp[a] >= 0 && grp[b] >= 0 && abs(dx[a] - dx[b]) <= 1 &&
+          abs(dy[a] - dy[b]) <= 1) {
+        int ra = a, rb = b;
+        while (grp[ra] != ra) ra = grp[ra];
+        while (grp[rb] != rb) rb = grp[rb];
+        if (ra != rb) grp[rb] = ra;
+      }
+  int rep[8]; // rep[g] = un voisin représentant le groupe g
+  for (int a = 0; a < 8; a++)
+    if (grp[a] == a) rep[ng++] = a;
+  if (ng <= 1) return; // la connexité ne change pas
+
+  // scission possible: parcours simultanés depuis chaque groupe, dans
+  // une même file. cls[] est un union-find sur les parcours (fusionnés
+  // quand ils se rencontrent), pending[r] = nombre de cases en attente
+  // dans la file pour le parcours de racine r, alive = nombre de
+  // parcours (fusionnés) qui ne sont pas épuisés.
+  if (++C->stamp == 1u << 28) {
+    memset(C->seen, 0, (size_t)C->X * C->Y * sizeof(*C->seen));
+    C->stamp = 1;
+  }
+  const unsigned base = C->stamp << 3;
+  int *Q = C->queue, head = 0, tail = 0;
+  int cls[8], pending[8], cut[8], ncut = 0, alive = ng;
+  for (int g = 0; g < ng; g++) {
+    const int c = (x + dx[rep[g]]) * C->Y + y + dy[rep[g]];
+    cls[g] = g, pending[g] = 1;
+    C->seen[c] = base | g;
+    Q[tail++] = c;
+  }
+  while (alive > 1) {
+    const int c = Q[head++];
+    int g = C->seen[c] & 7;
+    while (cls[g] != g) g = cls[g];
+    pending[g]--;
+    const int i = c / C->Y, j = c % C->Y;
+    for (int a = 0; a < 8; a++) {
+      const int u = i + dx[a], v = j + dy[a];
+      if (u < 0 || v < 0 || u >= C->X || v >= C->Y) continue;
+      const int d = u * C->Y + v;
+      if (C->label[d] != old) continue;
+      if ((C->seen[d] >> 3) == C->stamp) { // rencontre d'un parcours
+        int h = C->seen[d] & 7;
+        while (cls[h] != h) h = cls[h];
+        if (h != g) cls[h] = g, pending[g] += pending[h], alive--;
+        continue;
+      }
+      C->seen[d] = base | g;
+      Q[tail++] = d;
+      pending[g]++;
+    }
+    if (pending[g] == 0) cut[ncut++] = c, alive--; // partie coupée
+  }
+
+  // chaque partie coupée reçoit une nouvelle étiquette, la dernière
+  // partie encore en cours de parcours garde old
+  for (int k = 0; k < ncut; k++) relabel(C, cut[k], old, C->next++);
+}
+#undef STRIP
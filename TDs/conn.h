@@ -0,0 +1,56 @@
+#ifndef CONN_H
+#define CONN_H
+#include "tools.h"
+
+// Index de connexité d'une grille: chaque case qui n'est pas un mur
+// reçoit l'étiquette de sa composante connexe (pour le 8-voisinage,
+// celui de A*), les murs ont l'étiquette -1. Deux positions s,t sont
+// reliées par un chemin ssi elles ont la même étiquette (>=0), ce qui
+// permet de rejeter en O(1) les requêtes sans chemin au lieu de
+// laisser A* parcourir toute la composante de s.
+//
+//  X,Y   = dimensions de la grille indexée
+//  label = label[i*Y+j] = étiquette de la case (i,j)
+//  next  = prochaine étiquette libre (utilisée lors des scissions)
+//  queue = file de X*Y cases pour les parcours de connAddWall()
+//  seen  = seen[i*Y+j] = (stamp<<3)|g si la case (i,j) a été atteinte
+//          par le parcours g lors du dernier appel à connAddWall()
+//  stamp = numéro du dernier appel (<2^28), ce qui évite d'effacer seen[]
+
+typedef struct {
+  int X, Y;
+  int *label;
+  int next;
+  int *queue;
+  unsigned *seen, stamp;
+} conn;
+
+
+// Construit l'index de la grille G. L'étiquetage se fait par
+// union-find sur des bandes de colonnes traitées en parallèle (OpenMP),
+// puis les bandes sont recollées.
+conn connCreate(grid G);
+
+
+// Libère la mémoire allouée par connCreate().
+void connFree(conn C);
+
+
+// Vrai ssi il existe un chemin entre s et t dans la grille indexée.
+static inline bool connSame(conn *C, position s, position t) {
+  int a = C->label[s.x * C->Y + s.y];
+  return (a >= 0) && (a == C->label[t.x * C->Y + t.y]);
+}
+
+
+// Place un mur en (x,y) dans la grille G et met l'index à jour. Si les
+// voisins de (x,y) restent reliés autour de la case, rien d'autre
+// n'est fait (cas le plus courant). Sinon un parcours en largeur part
+// de chaque groupe de voisins, tous en même temps, jusqu'à ce qu'il
+// n'en reste qu'un: les parcours qui se rencontrent fusionnent, et
+// seuls ceux qui s'épuisent (les parties coupées) sont ré-étiquetés.
+// Le coût est donc de l'ordre de la taille des parties coupées, et non
+// de celle de toute la composante.
+void connAddWall(conn *C, grid G, int x, int y);
+
+#endif
@@ -0,0 +1,457 @@
+#include "prof.h"
+
+#ifdef PROF
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#ifdef PROF_MEM
+#include <malloc.h>
+#define MEM 1
+#else
+#define MEM 0
+#endif
+
+// compteurs matériels (cf. PROF_PERF dans prof.h)
+#define NCNT 6
+static const char *cntName[NCNT] = {"cycles",   "instr",   "L1d-miss",
+                                    "LLC-miss", "br-miss", "faults"};
+
+// allocations d'une zone (cf. PROF_MEM dans prof.h), sous-zones
+// comprises. La classe de taille h compte les demandes de 2^(h+2)+1 à
+// 2^(h+3) octets, la dernière tout ce qui dépasse.
+#define NHIST 16
+typedef struct {
+  uint64_t n, nfree, bytes; // allocations, libérations, octets demandés
+  int64_t live, peak;       // octets réservés depuis le début de la zone
+  uint32_t hist[NHIST];     // nombre d'allocations par classe de taille
+} mstat;
+
+// une zone terminée ou en cours (t1 = 0)
+typedef struct {
+  const char *name;
+  uint64_t t0, t1;
+  uint64_t self; // durée hors sous-zones, calculée par profReport()
+  int depth;
+} zone;
+
+// tampon d'un thread, chaînés dans la liste head
+typedef struct pbuf {
+  zone *Z;               // zones dans l'ordre de leur début
+  uint64_t (*C)[NCNT];   // C[k] = compteurs pendant Z[k] (si fd >= 0)
+  int n, nmax;           // nombre de zones et taille de Z
+  int tid;               // numéro du thread pour la trace
+  int depth;             // nombre de zones ouvertes
+  int open[PROF_DEPTH];  // indices dans Z des zones ouvertes
+  int fd;                // groupe de compteurs du thread, ou -1
+  int slot[NCNT];        // rang du compteur c dans le groupe, ou -1
+  uint64_t c0[PROF_DEPTH][NCNT]; // compteurs au début des zones ouvertes
+  mstat *M;              // M[k] = allocations pendant Z[k] (si MEM)
+  mstat m0[PROF_DEPTH];  // allocations des zones ouvertes
+  struct pbuf *next;
+} pbuf;
+
+static _Atomic(pbuf *) head;
+static atomic_int ntid;
+static _Thread_local pbuf *mine;
+static atomic_uint cntMask; // bit c = compteur c ouvert par un thread
+static _Thread_local bool busy; // allocation du profileur, non comptée
+static atomic_llong memN, memBytes, memPeak; // tout le processus
+
+// Ouvre les compteurs du thread courant en un seul groupe, lu en un
+// appel système. Le premier compteur ouvert est le chef du groupe; ceux
+// que le noyau ou la machine (virtuelle) refusent sont ignorés.
+static void perfOpen(pbuf *B) {
+  B->fd = -1;
+  for (int c = 0; c < NCNT; c++) B->slot[c] = -1;
+#ifdef __linux__
+  const char *e = getenv("PROF_PERF");
+  if (e == NULL || atoi(e) == 0) return;
+#define CACHE(c) ((c) | PERF_COUNT_HW_CACHE_OP_READ << 8 | \
+                  PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+  static const struct { uint32_t type; uint64_t config; } ev[NCNT] = {
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+      {PERF_TYPE_HW_CACHE, CACHE(PERF_COUNT_HW_CACHE_L1D)},
+      {PERF_TYPE_HW_CACHE, CACHE(PERF_COUNT_HW_CACHE_LL)},
+      {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+      {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+  };
+#undef CACHE
+  int n = 0;
+  for (int c = 0; c < NCNT; c++) {
+    struct perf_event_attr a;
+    memset(&a, 0, sizeof(a));
+    a.size = sizeof(a);
+    a.type = ev[c].type;
+    a.config = ev[c].config;
+    a.read_format = PERF_FORMAT_GROUP;
+    a.exclude_kernel = a.exclude_hv = 1; // permis avec perf_event_paranoid=2
+    const int fd = syscall(SYS_perf_event_open, &a, 0, -1, B->fd, 0);
+    if (fd < 0) continue;
+    if (B->fd < 0) B->fd = fd;
+    B->slot[c] = n++;
+    atomic_fetch_or(&cntMask, 1u << c);
+  }
+#endif
+}
+
+// Lit les compteurs du thread dans v[] (0 pour ceux qui manquent).
+static void perfRead(pbuf *B, uint64_t *v) {
+  if (B->fd < 0) return;
+#ifdef __linux__
+  uint64_t r[1 + NCNT]; // nombre de compteurs, puis leurs valeurs
+  // appel système direct: un programme peut définir sa propre fonction
+  // read() (cf. TP2019/tp.h)
+  if (syscall(SYS_read, B->fd, r, sizeof(r)) <= 0) return;
+  for (int c = 0; c < NCNT; c++)
+    v[c] = B->slot[c] < 0 ? 0 : r[1 + B->slot[c]];
+#endif
+}
+
+// Tampon du thread courant, créé et ajouté (sans verrou) à la liste au
+// premier appel.
+static pbuf *buffer(void) {
+  if (mine) return mine;
+  busy = true;
+  pbuf *B = calloc(1, sizeof(*B));
+  busy = false;
+  perfOpen(B);
+  B->tid = atomic_fetch_add(&ntid, 1);
+  B->next = atomic_load(&head);
+  while (!atomic_compare_exchange_weak(&head, &B->next, B))
+    ;
+  return mine = B;
+}
+
+void profBegin(const char *name) {
+  pbuf *B = buffer();
+  if (B->depth < PROF_DEPTH) {
+    if (B->n == B->nmax) {
+      busy = true;
+      B->nmax = B->nmax ? 2 * B->nmax : 1024;
+      B->Z = realloc(B->Z, B->nmax * sizeof(*B->Z));
+      if (B->fd >= 0) B->C = realloc(B->C, B->nmax * sizeof(*B->C));
+      if (MEM) B->M = realloc(B->M, B->nmax * sizeof(*B->M));
+      busy = false;
+    }
+    B->open[B->depth] = B->n;
+    B->Z[B->n++] = (zone){name, 0, 0, 0, B->depth};
+    if (MEM) memset(&B->m0[B->depth], 0, sizeof(mstat));
+  }
+  B->depth++;
+  // lecture des compteurs et de l'horloge en dernier, pour ne pas
+  // compter l'ajout
+  if (B->depth <= PROF_DEPTH) {
+    perfRead(B, B->c0[B->depth - 1]);
+    B->Z[B->n - 1].t0 = profNow();
+  }
+}
+
+void profEnd(void) {
+  const uint64_t t = profNow();
+  pbuf *B = buffer();
+  if (B->depth == 0) return; // PROF_END() sans PROF_BEGIN()
+  if (--B->depth >= PROF_DEPTH) return;
+  const int k = B->open[B->depth];
+  B->Z[k].t1 = t;
+  if (B->fd >= 0) {
+    perfRead(B, B->C[k]);
+    for (int c = 0; c < NCNT; c++) B->C[k][c] -= B->c0[B->depth][c];
+  }
+  if (MEM) {
+    // la zone parente hérite des allocations de celle-ci
+    B->M[k] = B->m0[B->depth];
+    const mstat *m = &B->M[k];
+    if (B->depth == 0) return;
+    mstat *p = &B->m0[B->depth - 1];
+    p->n += m->n, p->nfree += m->nfree, p->bytes += m->bytes;
+    for (int h = 0; h < NHIST; h++) p->hist[h] += m->hist[h];
+    if (p->live + m->peak > p->peak) p->peak = p->live + m->peak;
+    p->live += m->live;
+  }
+}
+
+#ifdef PROF_MEM
+// Compte une allocation de size octets (alloc) ou une libération, la
+// mémoire réservée variant de delta octets.
+static atomic_llong memLive;
+
+static void memNote(size_t size, int64_t delta, bool alloc) {
+  if (busy) return;
+  const long long l =
+      atomic_fetch_add_explicit(&memLive, delta, memory_order_relaxed) + delta;
+  long long p = atomic_load_explicit(&memPeak, memory_order_relaxed);
+  while (l > p && !atomic_compare_exchange_weak(&memPeak, &p, l))
+    ;
+  if (alloc) {
+    atomic_fetch_add_explicit(&memN, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&memBytes, size, memory_order_relaxed);
+  }
+
+  pbuf *B = mine;
+  if (B == NULL || B->depth == 0 || B->depth > PROF_DEPTH) return;
+  mstat *m = &B->m0[B->depth - 1];
+  if (alloc) {
+    int h = 0;
+    while (h < NHIST - 1 && size > (size_t)8 << h) h++;
+    m->n++, m->bytes += size, m->hist[h]++;
+  } else
+    m->nfree++;
+  m->live += delta;
+  if (m->live > m->peak) m->peak = m->live;
+}
+
+// Fonctions substituées à malloc() & co. par l'éditeur de liens
+// (-Wl,--wrap=malloc, ...), les vraies étant __real_xxx(). La mémoire
+// réservée est mesurée par malloc_usable_size().
+void *__real_malloc(size_t n);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t n);
+void __real_free(void *p);
+
+void *__wrap_malloc(size_t n) {
+  void *p = __real_malloc(n);
+  if (p) memNote(n, malloc_usable_size(p), true);
+  return p;
+}
+
+void *__wrap_calloc(size_t n, size_t size) {
+  void *p = __real_calloc(n, size);
+  if (p) memNote(n * size, malloc_usable_size(p), true);
+  return p;
+}
+
+void *__wrap_realloc(void *q, size_t n) {
+  const int64_t u = q ? malloc_usable_size(q) : 0;
+  void *p = __real_realloc(q, n);
+  if (p) memNote(n, (int64_t)malloc_usable_size(p) - u, true);
+  else if (n == 0 && q) memNote(0, -u, false); // realloc(q,0) libère q
+  return p;
+}
+
+void __wrap_free(void *p) {
+  if (p) memNote(0, -(int64_t)malloc_usable_size(p), false);
+  __real_free(p);
+}
+#endif
+
+// une zone terminée et ses compteurs (ou NULL), pour le rapport
+typedef struct {
+  const zone *z;
+  const uint64_t *cnt;
+  const mstat *mem;
+} ref;
+
+// Compare deux zones par nom puis par durée.
+static int cmpZone(const void *x, const void *y) {
+  const zone *a = ((const ref *)x)->z, *b = ((const ref *)y)->z;
+  const int c = a->name == b->name ? 0 : strcmp(a->name, b->name);
+  if (c) return c;
+  const uint64_t u = a->t1 - a->t0, v = b->t1 - b->t0;
+  return (u > v) - (u < v);
+}
+
+// Écrit la durée t (en ns) dans s avec une unité adaptée.
+static char *fmtTime(char *s, double t) {
+  if (t < 1E3) sprintf(s, "%.0fns", t);
+  else if (t < 1E6) sprintf(s, "%.2fus", t / 1E3);
+  else if (t < 1E9) sprintf(s, "%.2fms", t / 1E6);
+  else sprintf(s, "%.3fs", t / 1E9);
+  return s;
+}
+
+// Écrit le nombre x dans s avec un suffixe K, M ou G.
+static char *fmtCount(char *s, double x) {
+  if (x < 1E4) sprintf(s, "%.0f", x);
+  else if (x < 1E7) sprintf(s, "%.1fK", x / 1E3);
+  else if (x < 1E10) sprintf(s, "%.1fM", x / 1E6);
+  else sprintf(s, "%.1fG", x / 1E9);
+  return s;
+}
+
+// statistiques d'un nom de zone
+typedef struct {
+  const char *name;
+  int count;
+  double total, self, min, max, p50, p90, p99;
+  double cnt[NCNT]; // somme des compteurs sur les appels
+  mstat mem;        // sommes des allocations, plus grand pic
+} stat;
+
+static int cmpStat(const void *x, const void *y) {
+  const stat *a = x, *b = y;
+  return (a->total < b->total) - (a->total > b->total);
+}
+
+// Calcule le temps propre de chaque zone terminée de B: sa durée moins
+// celle de ses sous-zones directes, qui la suivent dans B->Z.
+static void selfTime(pbuf *B) {
+  int open[PROF_DEPTH], d = 0;
+  for (int k = 0; k < B->n; k++) {
+    zone *z = &B->Z[k];
+    z->self = z->t1 ? z->t1 - z->t0 : 0;
+    while (d && B->Z[open[d - 1]].depth >= z->depth) d--;
+    if (d) B->Z[open[d - 1]].self -= z->self;
+    open[d++] = k;
+  }
+}
+
+void profReport(FILE *f) {
+  busy = true;
+  // toutes les zones terminées, triées par nom puis par durée
+  int n = 0;
+  for (pbuf *B = atomic_load(&head); B; B = B->next) n += B->n, selfTime(B);
+  ref *Z = malloc(n * sizeof(*Z));
+  n = 0;
+  for (pbuf *B = atomic_load(&head); B; B = B->next)
+    for (int k = 0; k < B->n; k++)
+      if (B->Z[k].t1)
+        Z[n++] = (ref){&B->Z[k], B->C ? B->C[k] : NULL, MEM ? &B->M[k] : NULL};
+  qsort(Z, n, sizeof(*Z), cmpZone);
+
+  // une statistique par nom, percentiles au rang le plus proche
+  stat *S = malloc(n * sizeof(*S));
+  int m = 0;
+  for (int a = 0, b; a < n; a = b) {
+    for (b = a + 1; b < n && !strcmp(Z[a].z->name, Z[b].z->name); b++)
+      ;
+    stat *s = &S[m++];
+    const int c = b - a;
+#define DUR(k) (double)(Z[a + (k)].z->t1 - Z[a + (k)].z->t0)
+#define PCT(p) DUR((int)((p) * c + 0.999999) - 1)
+    s->name = Z[a].z->name, s->count = c;
+    s->total = s->self = 0;
+    for (int i = 0; i < NCNT; i++) s->cnt[i] = 0;
+    memset(&s->mem, 0, sizeof(s->mem));
+    for (int k = 0; k < c; k++) {
+      s->total += DUR(k), s->self += Z[a + k].z->self;
+      if (Z[a + k].cnt)
+        for (int i = 0; i < NCNT; i++) s->cnt[i] += Z[a + k].cnt[i];
+      const mstat *m = Z[a + k].mem;
+      if (m == NULL) continue;
+      s->mem.n += m->n, s->mem.nfree += m->nfree, s->mem.bytes += m->bytes;
+      for (int h = 0; h < NHIST; h++) s->mem.hist[h] += m->hist[h];
+      if (m->peak > s->mem.peak) s->mem.peak = m->peak;
+    }
+    s->min = DUR(0), s->max = DUR(c - 1);
+    s->p50 = PCT(0.50), s->p90 = PCT(0.90), s->p99 = PCT(0.99);
+#undef PCT
+#undef DUR
+  }
+  qsort(S, m, sizeof(*S), cmpStat);
+
+  // total compte plusieurs fois les appels imbriqués d'une zone
+  // récursive, pas self (temps hors sous-zones); les compteurs, comme
+  // total, incluent les sous-zones
+  const unsigned mask = atomic_load(&cntMask);
+  char t[7][16];
+  fprintf(f, "%-24s %9s %10s %10s %10s %10s %10s %10s %10s", "zone",
+          "count", "total", "self", "min", "p50", "p90", "p99", "max");
+  for (int i = 0; i < NCNT; i++)
+    if (mask >> i & 1) fprintf(f, " %9s", cntName[i]);
+  if ((mask & 3) == 3) fprintf(f, " %5s", "IPC");
+  if (MEM) fprintf(f, " %9s %9s %9s", "allocs", "bytes", "peak");
+  fprintf(f, "\n");
+  for (int k = 0; k < m; k++) {
+    fprintf(f, "%-24s %9d %10s %10s %10s %10s %10s %10s %10s", S[k].name,
+            S[k].count, fmtTime(t[0], S[k].total), fmtTime(t[1], S[k].self),
+            fmtTime(t[2], S[k].min), fmtTime(t[3], S[k].p50),
+            fmtTime(t[4], S[k].p90), fmtTime(t[5], S[k].p99),
+            fmtTime(t[6], S[k].max));
+    for (int i = 0; i < NCNT; i++)
+      if (mask >> i & 1) fprintf(f, " %9s", fmtCount(t[0], S[k].cnt[i]));
+    if ((mask & 3) == 3)
+      fprintf(f, " %5.2f", S[k].cnt[0] ? S[k].cnt[1] / S[k].cnt[0] : 0.0);
+    if (MEM)
+      fprintf(f, " %9s %9s %9s", fmtCount(t[0], S[k].mem.n),
+              fmtCount(t[1], S[k].mem.bytes), fmtCount(t[2], S[k].mem.peak));
+    fprintf(f, "\n");
+  }
+
+  if (MEM) {
+    // classes de taille des allocations, par zone
+    fprintf(f, "\n%-24s", "allocs <= bytes");
+    for (int h = 0; h < NHIST; h++) {
+      const int b = 8 << (h < NHIST - 1 ? h : h - 1);
+      sprintf(t[0], b < 1024 ? "%s%d" : "%s%dK", h < NHIST - 1 ? "" : ">",
+              b < 1024 ? b : b / 1024);
+      fprintf(f, " %7s", t[0]);
+    }
+    fprintf(f, "\n");
+    for (int k = 0; k < m; k++) {
+      if (S[k].mem.n == 0) continue;
+      fprintf(f, "%-24s", S[k].name);
+      for (int h = 0; h < NHIST; h++)
+        fprintf(f, " %7s", fmtCount(t[0], S[k].mem.hist[h]));
+      fprintf(f, "\n");
+    }
+    fprintf(f, "processus: %s allocations, %s octets, pic %s octets\n",
+            fmtCount(t[0], atomic_load(&memN)),
+            fmtCount(t[1], atomic_load(&memBytes)),
+            fmtCount(t[2], atomic_load(&memPeak)));
+  }
+  free(S);
+  free(Z);
+  busy = false;
+}
+
+bool profTrace(const char *file) {
+  FILE *f = fopen(file, "w");
+  if (f == NULL) return false;
+
+  // origine des temps = début de la première zone
+  uint64_t t0 = UINT64_MAX;
+  for (pbuf *B = atomic_load(&head); B; B = B->next)
+    if (B->n && B->Z[0].t0 < t0) t0 = B->Z[0].t0;
+
+  // événements complets ("ph":"X"), temps en microsecondes
+  fprintf(f, "{\"traceEvents\":[");
+  const char *sep = "\n";
+  for (pbuf *B = atomic_load(&head); B; B = B->next)
+    for (int k = 0; k < B->n; k++) {
+      const zone *z = &B->Z[k];
+      if (!z->t1) continue;
+      fprintf(f, "%s{\"name\":\"", sep);
+      for (const char *c = z->name; *c; c++)
+        if (*c == '"' || *c == '\\') fprintf(f, "\\%c", *c);
+        else if ((unsigned char)*c >= ' ') fputc(*c, f);
+      fprintf(f, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+              B->tid, (z->t0 - t0) / 1E3, (z->t1 - z->t0) / 1E3);
+      if (B->fd >= 0 || MEM) { // compteurs et allocations dans "args"
+        const char *c = ",\"args\":{";
+        for (int i = 0; i < NCNT; i++)
+          if (B->slot[i] >= 0)
+            fprintf(f, "%s\"%s\":%llu", c, cntName[i],
+                    (unsigned long long)B->C[k][i]), c = ",";
+        if (MEM)
+          fprintf(f, "%s\"allocs\":%llu,\"bytes\":%llu,\"peak\":%lld", c,
+                  (unsigned long long)B->M[k].n,
+                  (unsigned long long)B->M[k].bytes, (long long)B->M[k].peak);
+        fprintf(f, "}");
+      }
+      fprintf(f, "}");
+      sep = ",\n";
+    }
+  fprintf(f, "\n]}\n");
+  return fclose(f) == 0;
+}
+
+static const char *exitFile;
+
+static void atExit(void) {
+  profReport(stderr);
+  if (exitFile && !profTrace(exitFile))
+    fprintf(stderr, "prof: impossible d'écrire %s\n", exitFile);
+}
+
+void profExit(const char *file) {
+  exitFile = file;
+  atexit(atExit);
+}
+
+#endif
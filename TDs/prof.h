@@ -0,0 +1,83 @@
+#ifndef PROF_H
+#define PROF_H
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+// Profilage par zones nommées, avec horloge monotone à la nanoseconde.
+//
+//  PROF_BEGIN("nom");  ... PROF_END();
+//
+// délimite une zone, les zones pouvant s'imbriquer (jusqu'à PROF_DEPTH
+// niveaux). Chaque thread enregistre ses zones dans son propre tampon,
+// sans verrou. En fin de programme:
+//
+//  PROF_REPORT(f)     écrit dans le flux f, pour chaque nom de zone: le
+//                     nombre d'appels, le temps total, le minimum, le
+//                     maximum et les percentiles 50, 90 et 99;
+//  PROF_TRACE(file)   écrit toutes les zones dans le fichier file au
+//                     format "trace event" JSON de Chrome, lisible par
+//                     chrome://tracing ou https://ui.perfetto.dev;
+//  PROF_EXIT(file)    fait les deux à la sortie du programme (atexit),
+//                     le rapport sur stderr et la trace dans file.
+//
+// Sous Linux, avec la variable d'environnement PROF_PERF=1, chaque
+// zone mesure aussi les compteurs matériels du thread (perf_event_open):
+// cycles, instructions, défauts de cache L1d et LLC, mauvaises
+// prédictions de branchement et défauts de page. Le rapport ajoute
+// leurs sommes (et l'IPC) par zone, la trace les met dans "args". Les
+// compteurs refusés (perf_event_paranoid, machine virtuelle, ...) sont
+// simplement omis. Chaque lecture est un appel système (~1us): à
+// réserver aux zones de la taille d'une phase.
+//
+// Compilé avec -DPROF_MEM et lié avec
+// -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc,--wrap=free (make
+// PROF=1 PROF_MEM=1, Linux seulement), le profileur compte aussi les
+// allocations: par zone, sous-zones comprises, le nombre d'allocations,
+// les octets demandés, le pic de mémoire réservée depuis le début de la
+// zone et la répartition des tailles demandées; pour tout le processus,
+// les totaux et le pic. Seuls les appels de notre code sont comptés, pas
+// ceux internes aux bibliothèques (fopen(), SDL, ...).
+//
+// Les tampons ne sont lus que par PROF_REPORT() et PROF_TRACE(), qui
+// doivent donc être appelées quand les autres threads ont terminé.
+//
+// Le profilage n'existe que si l'on compile avec -DPROF (make PROF=1):
+// sinon les macros PROF_xxx ne produisent aucun code. Le nom d'une zone
+// doit être une chaîne constante, seul son pointeur est mémorisé.
+
+#define PROF_DEPTH 64 // profondeur maximale d'imbrication
+
+// Temps en nanosecondes depuis une origine arbitraire (horloge monotone,
+// disponible même sans -DPROF).
+static inline uint64_t profNow(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000000000u + t.tv_nsec;
+}
+
+#ifdef PROF
+
+void profBegin(const char *name);
+void profEnd(void);
+void profReport(FILE *f);
+bool profTrace(const char *file);
+void profExit(const char *file);
+
+#define PROF_BEGIN(name) profBegin(name)
+#define PROF_END() profEnd()
+#define PROF_REPORT(f) profReport(f)
+#define PROF_TRACE(file) profTrace(file)
+#define PROF_EXIT(file) profExit(file)
+
+#else
+
+#define PROF_BEGIN(name) ((void)0)
+#define PROF_END() ((void)0)
+#define PROF_REPORT(f) ((void)0)
+#define PROF_TRACE(file) ((void)0)
+#define PROF_EXIT(file) ((void)0)
+
+#endif
+#endif
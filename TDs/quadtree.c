@@ -0,0 +1,140 @@
+#include "quadtree.h"
+
+// Contexte de la construction.
+typedef struct {
+  qtree *Q;
+  int (*value)(const void *, int, int);
+  const void *data;
+  int lmax, nmax; // tailles allouées pour Q->leaf et Q->node
+} qbuild;
+
+static int pushLeaf(qbuild *B, int x, int y, int s, int v) {
+  qtree *Q = B->Q;
+  if (Q->nleaf == B->lmax) {
+    B->lmax *= 2;
+    Q->leaf = realloc(Q->leaf, B->lmax * sizeof(*Q->leaf));
+  }
+  Q->leaf[Q->nleaf] = (qleaf){x, y, s, v};
+  return ~(Q->nleaf++);
+}
+
+static int pushNode(qbuild *B, int *c) {
+  qtree *Q = B->Q;
+  if (Q->nnode == B->nmax) {
+    B->nmax *= 2;
+    Q->node = realloc(Q->node, 4 * B->nmax * sizeof(*Q->node));
+  }
+  for (int k = 0; k < 4; k++) Q->node[4 * Q->nnode + k] = c[k];
+  return Q->nnode++;
+}
+
+// Construit le bloc [x,x+s[ x [y,y+s[ et renvoie son code (cf. root).
+// Les quatre fils sont construits d'abord. S'ils sont tous des
+// feuilles de même valeur, ce sont les quatre dernières feuilles
+// ajoutées: on les remplace par une seule.
+static int build(qbuild *B, int x, int y, int s) {
+  const qtree *Q = B->Q;
+  if (x >= Q->X || y >= Q->Y) // entièrement hors de la grille
+    return pushLeaf(B, x, y, s, V_WALL);
+  if (s == 1)
+    return pushLeaf(B, x, y, 1, B->value(B->data, x, y));
+
+  const int h = s / 2;
+  int c[4];
+  for (int k = 0; k < 4; k++)
+    c[k] = build(B, x + (k >> 1) * h, y + (k & 1) * h, h);
+
+  if (c[0] < 0 && c[1] < 0 && c[2] < 0 && c[3] < 0) {
+    const int v = Q->leaf[~c[0]].v;
+    if (v == Q->leaf[~c[1]].v && v == Q->leaf[~c[2]].v &&
+        v == Q->leaf[~c[3]].v) {
+      B->Q->nleaf -= 4;
+      return pushLeaf(B, x, y, s, v);
+    }
+  }
+  return pushNode(B, c);
+}
+
+qtree qtCreateFrom(int X, int Y, int (*value)(const void *, int, int),
+                   const void *data) {
+  qtree Q = {X, Y, 1, NULL, 0, NULL, 0, 0};
+  while (Q.S < X || Q.S < Y) Q.S *= 2;
+  qbuild B = {&Q, value, data, 64, 16};
+  Q.leaf = malloc(B.lmax * sizeof(*Q.leaf));
+  Q.node = malloc(4 * B.nmax * sizeof(*Q.node));
+  Q.root = build(&B, 0, 0, Q.S);
+  // rend la mémoire inutilisée
+  Q.leaf = realloc(Q.leaf, Q.nleaf * sizeof(*Q.leaf));
+  Q.node = realloc(Q.node, (4 * Q.nnode + 1) * sizeof(*Q.node));
+  return Q;
+}
+
+static int gridValue(const void *data, int i, int j) {
+  return ((const grid *)data)->value[i][j];
+}
+
+qtree qtCreate(grid G) {
+  return qtCreateFrom(G.X, G.Y, gridValue, &G);
+}
+
+void qtFree(qtree Q) {
+  free(Q.leaf);
+  free(Q.node);
+}
+
+int qtLeaf(const qtree *Q, int i, int j) {
+  if (i < 0 || j < 0 || i >= Q->S || j >= Q->S) return -1;
+  int c = Q->root, x = 0, y = 0, s = Q->S;
+  while (c >= 0) {
+    s /= 2;
+    const int a = (i >= x + s), b = (j >= y + s);
+    x += a * s, y += b * s;
+    c = Q->node[4 * c + 2 * a + b];
+  }
+  return ~c;
+}
+
+// Ajoute la feuille l à N[0..n-1] si elle n'y est pas déjà parmi N[n0..].
+static int addLeaf(int l, int n0, int n, int **N, int *nmax) {
+  if (l < 0) return n;
+  for (int k = n0; k < n; k++)
+    if ((*N)[k] == l) return n;
+  if (n == *nmax) {
+    *nmax = (*nmax) ? 2 * (*nmax) : 16;
+    *N = realloc(*N, (*nmax) * sizeof(**N));
+  }
+  (*N)[n] = l;
+  return n + 1;
+}
+
+int qtNeighbors(const qtree *Q, int l, int **N, int *nmax) {
+  const int x = Q->leaf[l].x, y = Q->leaf[l].y, s = Q->leaf[l].s;
+  int n = 0;
+
+  // Côtés: on saute d'une feuille voisine à la suivante. Deux côtés
+  // différents ne peuvent pas toucher la même feuille (elle contiendrait
+  // une case de l), il n'y a donc pas de doublons à chercher.
+  for (int j = y, v; j < y + s; j = Q->leaf[v].y + Q->leaf[v].s) { // gauche
+    if ((v = qtLeaf(Q, x - 1, j)) < 0) break;
+    n = addLeaf(v, n, n, N, nmax);
+  }
+  for (int j = y, v; j < y + s; j = Q->leaf[v].y + Q->leaf[v].s) { // droite
+    if ((v = qtLeaf(Q, x + s, j)) < 0) break;
+    n = addLeaf(v, n, n, N, nmax);
+  }
+  for (int i = x, v; i < x + s; i = Q->leaf[v].x + Q->leaf[v].s) { // haut
+    if ((v = qtLeaf(Q, i, y - 1)) < 0) break;
+    n = addLeaf(v, n, n, N, nmax);
+  }
+  for (int i = x, v; i < x + s; i = Q->leaf[v].x + Q->leaf[v].s) { // bas
+    if ((v = qtLeaf(Q, i, y + s)) < 0) break;
+    n = addLeaf(v, n, n, N, nmax);
+  }
+
+  // Coins: la feuille peut déjà avoir été vue le long d'un côté.
+  n = addLeaf(qtLeaf(Q, x - 1, y - 1), 0, n, N, nmax);
+  n = addLeaf(qtLeaf(Q, x - 1, y + s), 0, n, N, nmax);
+  n = addLeaf(qtLeaf(Q, x + s, y - 1), 0, n, N, nmax);
+  n = addLeaf(qtLeaf(Q, x + s, y + s), 0, n, N, nmax);
+  return n;
+}
@@ -0,0 +1,68 @@
+#ifndef QUADTREE_H
+#define QUADTREE_H
+#include "tools.h"
+
+// Représentation compressée d'une grille par un quadtree de régions:
+// la grille est plongée dans un carré de côté S = 2^k (les cases hors
+// de la grille sont des murs), et tout bloc carré aligné dont les cases
+// ont la même valeur V_xxx est une seule feuille. La mémoire est donc
+// proportionnelle au bord des obstacles (et des terrains), pas à X*Y.
+//
+//  X,Y   = dimensions de la grille représentée
+//  S     = côté du carré racine (puissance de 2, >= X et Y)
+//  leaf  = feuilles, chacune est le bloc [x,x+s[ x [y,y+s[ de valeur v
+//  node  = noeuds internes, node[4*n+c] = fils c du noeud n, codé >= 0
+//          pour un noeud interne et ~l (<0) pour la feuille l. Le fils
+//          c couvre le quart (c>>1, c&1) du bloc de son père.
+//  root  = racine, codée comme un fils
+
+typedef struct {
+  int x, y, s; // coin et côté du bloc
+  int v;       // valeur V_xxx de toutes les cases du bloc
+} qleaf;
+
+typedef struct {
+  int X, Y, S;
+  qleaf *leaf;
+  int nleaf;
+  int *node;
+  int nnode;
+  int root;
+} qtree;
+
+
+// Construit le quadtree de la grille G.
+qtree qtCreate(grid G);
+
+
+// Construit le quadtree d'une grille X x Y dont la case (i,j) vaut
+// value(data,i,j), ce qui permet de partir d'une grille qui n'est pas
+// en mémoire (cf. tmap.h) sans jamais allouer X*Y cases.
+qtree qtCreateFrom(int X, int Y, int (*value)(const void *, int, int),
+                   const void *data);
+
+
+// Libère la mémoire allouée par qtCreate().
+void qtFree(qtree Q);
+
+
+// Indice de la feuille contenant la case (i,j), ou -1 si (i,j) est
+// hors du carré racine.
+int qtLeaf(const qtree *Q, int i, int j);
+
+
+// Valeur de la case (i,j), l'équivalent de G.value[i][j] (V_WALL hors
+// de la grille).
+static inline int qtValue(const qtree *Q, int i, int j) {
+  int l = qtLeaf(Q, i, j);
+  return (l < 0) ? V_WALL : Q->leaf[l].v;
+}
+
+
+// Feuilles voisines de la feuille l pour le 8-voisinage (côtés et
+// coins), sans doublons. Elles sont écrites dans *N, un tableau de
+// taille *nmax agrandi si besoin (*N=NULL et *nmax=0 au départ).
+// Renvoie leur nombre.
+int qtNeighbors(const qtree *Q, int l, int **N, int *nmax);
+
+#endif
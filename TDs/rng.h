@@ -0,0 +1,102 @@
+#ifndef RNG_H
+#define RNG_H
+#include <stddef.h>
+#include <stdint.h>
+
+// Générateur pseudo-aléatoire xoshiro256** (Blackman & Vigna). Chaque
+// générateur a son propre état, ce qui permet d'en avoir un par thread
+// ou par tuile sans partager l'état global (et le verrou) de random(),
+// et de rejouer une génération à partir de sa graine. Tous les
+// générateurs d'instances (tools.h) prennent un rng* en paramètre.
+//
+// Pour générer en parallèle, on découpe le travail en blocs de taille
+// fixe et le bloc c utilise le flot obtenu après c sauts (rngJump()):
+// le résultat ne dépend alors que de la graine, pas du nombre de
+// threads (cf. rngStreams()).
+
+typedef struct {
+  uint64_t s[4];
+} rng;
+
+
+static inline uint64_t rngRotl(uint64_t x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+
+
+// Initialise R à partir d'une graine quelconque (via splitmix64, pour
+// que des graines proches donnent des états sans rapport).
+static inline void rngSeed(rng *R, uint64_t seed) {
+  for (int k = 0; k < 4; k++) {
+    uint64_t z = (seed += 0x9e3779b97f4a7c15);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    R->s[k] = z ^ (z >> 31);
+  }
+}
+
+
+// Renvoie 64 bits aléatoires.
+static inline uint64_t rngNext(rng *R) {
+  uint64_t *s = R->s;
+  const uint64_t r = rngRotl(s[1] * 5, 7) * 9;
+  const uint64_t t = s[1] << 17;
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rngRotl(s[3], 45);
+  return r;
+}
+
+
+// Renvoie un entier aléatoire de [0,n[, n>0 (méthode de Lemire, sans
+// division; le biais est < n/2^32).
+static inline uint32_t rngBelow(rng *R, uint32_t n) {
+  return ((rngNext(R) >> 32) * n) >> 32;
+}
+
+
+// Renvoie un réel aléatoire de [0,1[.
+static inline double rngDouble(rng *R) {
+  return (rngNext(R) >> 11) * 0x1.0p-53;
+}
+
+
+// Remplit A[0..n-1] de réels aléatoires de [0,1[.
+static inline void rngFill(rng *R, double *A, size_t n) {
+  for (size_t k = 0; k < n; k++)
+    A[k] = rngDouble(R);
+}
+
+
+// Avance R de 2^128 tirages: les flots obtenus par sauts successifs
+// ne se recouvrent pas.
+static inline void rngJump(rng *R) {
+  static const uint64_t J[4] = {0x180ec6d33cfd0aba, 0xd5a61266f0c9392c,
+                                0xa9582618e03fc9aa, 0x39abdc4529b1661c};
+  uint64_t t[4] = {0, 0, 0, 0};
+  for (int k = 0; k < 4; k++)
+    for (int b = 0; b < 64; b++) {
+      if (J[k] >> b & 1)
+        for (int l = 0; l < 4; l++)
+          t[l] ^= R->s[l];
+      rngNext(R);
+    }
+  for (int l = 0; l < 4; l++)
+    R->s[l] = t[l];
+}
+
+
+// Écrit dans S[0..c-1] les flots de c blocs indépendants: S[0]=*R,
+// S[1]=*R après un saut, etc. R est ensuite avancé de c sauts, pour
+// que les tirages suivants soient indépendants de ces blocs.
+static inline void rngStreams(rng *R, rng *S, int c) {
+  for (int k = 0; k < c; k++) {
+    S[k] = *R;
+    rngJump(R);
+  }
+}
+
+#endif
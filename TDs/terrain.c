@@ -0,0 +1,130 @@
+#include "terrain.h"
+
+static inline bool inside(terrain *T, int i, int j) {
+  return i > 0 && j > 0 && i < T->X - 1 && j < T->Y - 1;
+}
+
+// Ajoute la case c=(i,j) à la liste du type v. Les valeurs qui ne sont
+// pas des types de terrain (>= NVALUE) ne sont pas indexées.
+static void add(terrain *T, int v, int i, int j) {
+  if (v >= NVALUE)
+    return;
+  if (T->count[v] == T->cap[v]) {
+    T->cap[v] = T->cap[v] ? 2 * T->cap[v] : 64;
+    T->list[v] = realloc(T->list[v], T->cap[v] * sizeof(int));
+  }
+  const int c = i * T->Y + j;
+  T->where[c] = T->count[v];
+  T->list[v][T->count[v]++] = c;
+
+  if (T->dirty[v])
+    return;
+  position *B = T->box[v];
+  if (T->count[v] == 1) {
+    B[0].x = B[1].x = i, B[0].y = B[1].y = j;
+    return;
+  }
+  if (i < B[0].x) B[0].x = i;
+  if (j < B[0].y) B[0].y = j;
+  if (i > B[1].x) B[1].x = i;
+  if (j > B[1].y) B[1].y = j;
+}
+
+// Retire la case (i,j) de la liste du type v: la dernière case de la
+// liste prend sa place.
+static void removeCell(terrain *T, int v, int i, int j) {
+  const int c = i * T->Y + j, k = T->where[c];
+  const int last = T->list[v][--T->count[v]];
+  T->list[v][k] = last;
+  T->where[last] = k;
+
+  const position *B = T->box[v];
+  if (i == B[0].x || j == B[0].y || i == B[1].x || j == B[1].y)
+    T->dirty[v] = true; // la boîte peut rétrécir
+}
+
+terrain terrainCreate(grid G) {
+  terrain T;
+  memset(&T, 0, sizeof(T));
+  T.X = G.X, T.Y = G.Y;
+  T.where = malloc((size_t)G.X * G.Y * sizeof(*T.where));
+  for (int i = 1; i < G.X - 1; i++)
+    for (int j = 1; j < G.Y - 1; j++)
+      add(&T, G.value[i][j], i, j);
+  return T;
+}
+
+void terrainFree(terrain T) {
+  for (int v = 0; v < NVALUE; v++)
+    free(T.list[v]);
+  free(T.where);
+}
+
+void terrainSet(terrain *T, grid G, int i, int j, int v) {
+  const int u = G.value[i][j];
+  setValue(G, i, j, v);
+  if (u == v || !inside(T, i, j))
+    return;
+  if (u < NVALUE)
+    removeCell(T, u, i, j);
+  add(T, v, i, j);
+}
+
+position terrainRandom(terrain *T, unsigned types, rng *R) {
+  position p = {-1, -1};
+  long n = 0;
+  for (int v = 0; v < NVALUE; v++)
+    if (types >> v & 1)
+      n += T->count[v];
+  if (n == 0)
+    return p;
+  long r = rngBelow(R, n);
+  for (int v = 0; v < NVALUE; v++) {
+    if (!(types >> v & 1))
+      continue;
+    if (r < T->count[v]) {
+      p.x = T->list[v][r] / T->Y, p.y = T->list[v][r] % T->Y;
+      break;
+    }
+    r -= T->count[v];
+  }
+  return p;
+}
+
+int terrainSample(terrain *T, int v, int k, position *P, rng *R) {
+  const int n = T->count[v];
+  int *L = T->list[v];
+  if (k > n)
+    k = n;
+  // mélange partiel de Fisher-Yates: L[0..k-1] est un tirage uniforme
+  // sans remise, l'ordre de la liste n'ayant pas d'importance
+  for (int a = 0; a < k; a++) {
+    const int r = a + rngBelow(R, n - a);
+    const int c = L[r];
+    L[r] = L[a], T->where[L[r]] = r;
+    L[a] = c, T->where[c] = a;
+    P[a].x = c / T->Y, P[a].y = c % T->Y;
+  }
+  return k;
+}
+
+bool terrainBox(terrain *T, int v, position *min, position *max) {
+  if (T->count[v] == 0)
+    return false;
+  if (T->dirty[v]) {
+    position *B = T->box[v];
+    B[0].x = B[0].y = INT_MAX;
+    B[1].x = B[1].y = -1;
+    for (int k = 0; k < T->count[v]; k++) {
+      const int i = T->list[v][k] / T->Y, j = T->list[v][k] % T->Y;
+      if (i < B[0].x) B[0].x = i;
+      if (j < B[0].y) B[0].y = j;
+      if (i > B[1].x) B[1].x = i;
+      if (j > B[1].y) B[1].y = j;
+    }
+    T->dirty[v] = false;
+  }
+  *min = T->box[v][0];
+  *max = T->box[v][1];
+  return true;
+}
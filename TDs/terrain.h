@@ -0,0 +1,65 @@
+#ifndef TERRAIN_H
+#define TERRAIN_H
+#include "tools.h"
+
+// Index des cases d'une grille par type de terrain (valeurs V_xxx de
+// .value), hors le bord de la grille comme pour les positions
+// aléatoires de initGridPoints(). Pour chaque type v, les cases sont
+// rangées dans une liste dense, ce qui donne le nombre de cases en O(1)
+// et une case uniforme en O(1). L'index reste à jour si la grille n'est
+// modifiée qu'au travers de terrainSet(). Les cases dont la valeur
+// n'est pas un type de terrain (>= NVALUE, comme M_NULL que peut
+// produire initGridPoints()) ne sont pas indexées.
+//
+//  X,Y      = dimensions de la grille indexée
+//  count[v] = nombre de cases de type v
+//  list[v]  = list[v][0..count[v]-1] = cases de type v, codées i*Y+j
+//  where    = where[i*Y+j] = indice de la case (i,j) dans sa liste
+//  box[v]   = boîte englobante des cases de type v: box[v][0] = coin
+//             (min x, min y) et box[v][1] = (max x, max y), recalculée
+//             à la demande si dirty[v] (cf. terrainBox())
+
+#define NVALUE (V_TUNNEL + 1) // nombre de types de terrain
+
+typedef struct {
+  int X, Y;
+  int count[NVALUE];
+  int *list[NVALUE];
+  int cap[NVALUE];
+  int *where;
+  position box[NVALUE][2];
+  bool dirty[NVALUE];
+} terrain;
+
+
+// Construit l'index de la grille G en un seul parcours.
+terrain terrainCreate(grid G);
+
+
+// Libère la mémoire allouée par terrainCreate().
+void terrainFree(terrain T);
+
+
+// Met la case (i,j) de G au type v et met l'index à jour en O(1). Les
+// cases du bord sont modifiées sans être indexées.
+void terrainSet(terrain *T, grid G, int i, int j, int v);
+
+
+// Renvoie une case uniforme parmi celles dont le type est dans
+// l'ensemble types (bit v pour le type v, par exemple 1<<V_FREE), ou
+// (-1,-1) s'il n'y en a pas. Coût O(NVALUE).
+position terrainRandom(terrain *T, unsigned types, rng *R);
+
+
+// Tire k cases distinctes uniformes de type v et les écrit dans P[].
+// Renvoie le nombre de cases tirées, soit min(k,count[v]). Coût O(k).
+int terrainSample(terrain *T, int v, int k, position *P, rng *R);
+
+
+// Boîte englobante des cases de type v: renvoie false s'il n'y en a
+// aucune, sinon écrit les coins dans *min et *max. Elle n'est
+// recalculée (en O(count[v])) que si une case de type v a été retirée
+// depuis le dernier appel.
+bool terrainBox(terrain *T, int v, position *min, position *max);
+
+#endif
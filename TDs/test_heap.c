@@ -1,6 +1,7 @@
 /* test_heap.c */
 
 #include "heap.h"
+#include "rng.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
@@ -36,8 +37,9 @@ void print_heap(heap h, char format[]) {
 }
 
 int main(int argc, char *argv[]) {
-  srandom(time(NULL));
-  // srandom(1);
+  rng R;
+  rngSeed(&R, time(NULL));
+  // rngSeed(&R, 1);
   int n = (argv[1] && atoi(argv[1])) ? atoi(argv[1]) : 15;
   int T[n], S[n];
   heap h;
@@ -46,7 +48,7 @@ int main(int argc, char *argv[]) {
 
   printf("\nunsorted array: ");
   for (i = 0; i < n; i++) {
-    T[i] = random() % 100;
+    T[i] = rngBelow(&R, 100);
     printf(fmt, T[i]);
   }
   printf("\n\n");
@@ -0,0 +1,181 @@
+#include "tmap.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Taille totale du fichier pour une grille X x Y en tuiles de 2^s.
+static int64_t fileSize(int64_t X, int64_t Y, int s, int64_t *TX, int64_t *TY) {
+  const int64_t T = (int64_t)1 << s;
+  *TX = (X + T - 1) >> s;
+  *TY = (Y + T - 1) >> s;
+  return TMAP_HEADER + (*TX) * (*TY) * T * T;
+}
+
+// Crée le fichier file (vide, de la bonne taille) et écrit son
+// en-tête. Renvoie le descripteur, ou -1 en cas d'erreur.
+static int createFile(const char *file, int64_t X, int64_t Y, int s,
+                      position start, position end) {
+  int64_t TX, TY;
+  int fd = open(file, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+  if (fd < 0) {
+    printf("Cannot open file \"%s\"\n", file);
+    return -1;
+  }
+  char buffer[TMAP_HEADER] = {0};
+  tmap_header *H = (tmap_header *)buffer;
+  memcpy(H->magic, TMAP_MAGIC, 8);
+  H->X = X, H->Y = Y, H->shift = s;
+  H->start[0] = start.x, H->start[1] = start.y;
+  H->end[0] = end.x, H->end[1] = end.y;
+  if (ftruncate(fd, fileSize(X, Y, s, &TX, &TY)) ||
+      pwrite(fd, buffer, TMAP_HEADER, 0) != TMAP_HEADER) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Écrit la tuile (a,b) contenue dans tile[].
+static bool writeTile(int fd, const uint8_t *tile, int64_t a, int64_t b,
+                      int64_t TY, int s) {
+  const size_t n = (size_t)1 << (2 * s);
+  const off_t off = TMAP_HEADER + (a * TY + b) * (off_t)n;
+  return pwrite(fd, tile, n, off) == (ssize_t)n;
+}
+
+bool tmapWriteGrid(grid G, const char *file, int shift) {
+  int64_t TX, TY;
+  const int T = 1 << shift;
+  fileSize(G.X, G.Y, shift, &TX, &TY);
+  int fd = createFile(file, G.X, G.Y, shift, G.start, G.end);
+  if (fd < 0) return false;
+
+  uint8_t *tile = malloc((size_t)T * T);
+  bool ok = true;
+  for (int64_t a = 0; a < TX && ok; a++)
+    for (int64_t b = 0; b < TY && ok; b++) {
+      for (int i = 0; i < T; i++)
+        for (int j = 0; j < T; j++) {
+          const int64_t x = a * T + i, y = b * T + j;
+          tile[i * T + j] = (x < G.X && y < G.Y) ? G.value[x][y] : V_WALL;
+        }
+      ok = writeTile(fd, tile, a, b, TY, shift);
+    }
+
+  free(tile);
+  close(fd);
+  return ok;
+}
+
+bool tmapConvertText(const char *txt, const char *file, int shift) {
+  FILE *f = fopen(txt, "r");
+  if (f == NULL) {
+    printf("Cannot open file \"%s\"\n", txt);
+    return false;
+  }
+
+  char *L = NULL; // L=buffer pour la ligne de texte à lire
+  size_t b = 0;   // b=taille du buffer L utilisé (nulle au départ)
+  ssize_t n;      // n=nombre de caractères lus dans L, sans le '\0'
+
+  // Étape 1: taille de la grille et positions s/t, comme initGridFile()
+  int64_t X = 0, Y = 0;
+  position s = {-1, -1}, t = {-1, -1};
+  while ((n = getline(&L, &b, f)) > 0) {
+    if (L[0] != '#')
+      break;
+    if (L[n - 1] == '\n')
+      n--;
+    if (n > X)
+      X = n;
+    for (int i = 0; i < n; i++) {
+      if (L[i] == 's') s.x = i, s.y = Y;
+      if (L[i] == 't') t.x = i, t.y = Y;
+    }
+    Y++;
+  }
+  rewind(f);
+  if (X < 3)
+    X = 3;
+  if (Y < 3)
+    Y = 3;
+
+  int64_t TX, TY;
+  const int T = 1 << shift;
+  fileSize(X, Y, shift, &TX, &TY);
+  int fd = createFile(file, X, Y, shift, s, t);
+  if (fd < 0) {
+    fclose(f);
+    free(L);
+    return false;
+  }
+
+  // Étape 2: on lit T lignes (une bande de tuiles) à la fois. Dans la
+  // bande, la case (i,j) est en band[i*T+(j%T)], ce qui donne
+  // directement les tuiles les unes à la suite des autres.
+  uint8_t *band = malloc(TX * (size_t)T * T);
+  bool ok = true;
+  for (int64_t bt = 0; bt < TY && ok; bt++) {
+    memset(band, V_WALL, TX * (size_t)T * T);
+    for (int r = 0; r < T; r++) {
+      const int64_t j = bt * T + r;
+      if (j >= Y) break;
+      n = getline(&L, &b, f);
+      if (n > 0 && L[n - 1] == '\n')
+        n--;
+      for (int64_t i = 1; i < X - 1; i++) // bords à V_WALL, intérieur à V_FREE
+        band[i * T + r] = (j == 0 || j == Y - 1) ? V_WALL : V_FREE;
+      for (int64_t i = 0; i < n && i < X; i++)
+        band[i * T + r] = charValue(L[i]);
+    }
+    for (int64_t a = 0; a < TX && ok; a++)
+      ok = writeTile(fd, band + a * (size_t)T * T, a, bt, TY, shift);
+  }
+
+  free(band);
+  free(L);
+  fclose(f);
+  close(fd);
+  return ok;
+}
+
+tmap *tmapOpen(const char *file) {
+  int fd = open(file, O_RDONLY);
+  if (fd < 0) {
+    printf("Cannot open file \"%s\"\n", file);
+    return NULL;
+  }
+  struct stat st;
+  fstat(fd, &st);
+  void *base = NULL;
+  if (st.st_size >= TMAP_HEADER)
+    base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd); // la projection reste valide
+  if (base == NULL || base == MAP_FAILED) {
+    printf("Cannot map file \"%s\"\n", file);
+    return NULL;
+  }
+
+  const tmap_header *H = base;
+  int64_t TX, TY;
+  if (memcmp(H->magic, TMAP_MAGIC, 8) || H->shift < 0 || H->shift > 15 ||
+      fileSize(H->X, H->Y, H->shift, &TX, &TY) > st.st_size) {
+    printf("Bad tiled grid file \"%s\"\n", file);
+    munmap(base, st.st_size);
+    return NULL;
+  }
+
+  tmap *M = malloc(sizeof(*M));
+  M->X = H->X, M->Y = H->Y, M->shift = H->shift, M->TY = TY;
+  M->start.x = H->start[0], M->start.y = H->start[1];
+  M->end.x = H->end[0], M->end.y = H->end[1];
+  M->tiles = (const uint8_t *)base + TMAP_HEADER;
+  M->base = base;
+  M->size = st.st_size;
+  return M;
+}
+
+void tmapClose(tmap *M) {
+  munmap(M->base, M->size);
+  free(M);
+}
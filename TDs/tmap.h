@@ -0,0 +1,74 @@
+#ifndef TMAP_H
+#define TMAP_H
+#include "tools.h"
+
+// Grille binaire découpée en tuiles et projetée en mémoire (mmap), pour
+// les cartes trop grandes pour allocGrid() / initGridFile().
+//
+// Format du fichier (entiers little-endian):
+//
+//  - un en-tête de TMAP_HEADER octets (cf. tmap_header), complété par
+//    des zéros pour que les tuiles soient alignées sur des pages;
+//  - puis TX*TY tuiles de T*T octets (T = 2^shift), la tuile (a,b)
+//    couvrant les cases [a*T,(a+1)*T[ x [b*T,(b+1)*T[ est la tuile
+//    numéro a*TY+b. Dans une tuile, la case (i,j) est à l'octet
+//    (i%T)*T+(j%T). Chaque octet est une valeur V_xxx de tools.h; les
+//    cases hors de la grille (tuiles du bord) valent V_WALL.
+//
+// Seules les pages des tuiles touchées par une recherche sont lues
+// depuis le disque.
+
+#define TMAP_MAGIC "TAPTMAP1"
+#define TMAP_HEADER 4096
+
+typedef struct {
+  char magic[8];        // TMAP_MAGIC
+  int64_t X, Y;         // dimensions de la grille
+  int32_t shift;        // côté d'une tuile T = 2^shift
+  int32_t start[2];     // position de la source (ou -1,-1)
+  int32_t end[2];       // position de la destination (ou -1,-1)
+} tmap_header;
+
+typedef struct {
+  int64_t X, Y;         // dimensions de la grille
+  int shift;            // côté d'une tuile T = 2^shift
+  int64_t TY;           // nombre de tuiles dans la direction y
+  position start, end;  // source et destination
+  const uint8_t *tiles; // première tuile dans la projection
+  void *base;           // début de la projection
+  size_t size;          // taille de la projection
+} tmap;
+
+
+// Valeur de la case (i,j), l'équivalent de G.value[i][j]. Les cases
+// hors de la grille valent V_WALL comme le bord sentinelle d'une grid.
+static inline int tmapValue(const tmap *M, int64_t i, int64_t j) {
+  if (i < 0 || j < 0 || i >= M->X || j >= M->Y) return V_WALL;
+  const int s = M->shift;
+  const int64_t t = (i >> s) * M->TY + (j >> s); // numéro de la tuile
+  const int64_t m = ((int64_t)1 << s) - 1;
+  return M->tiles[(t << (2 * s)) + ((i & m) << s) + (j & m)];
+}
+
+
+// Ouvre en lecture le fichier file en le projetant en mémoire. Renvoie
+// NULL (avec un message) si le fichier n'est pas au bon format.
+tmap *tmapOpen(const char *file);
+
+
+// Ferme une grille ouverte par tmapOpen().
+void tmapClose(tmap *M);
+
+
+// Écrit la grille G (par exemple issue de initGridLaby() ou de
+// initGridPoints()) dans le fichier file avec des tuiles de côté
+// 2^shift. Renvoie false en cas d'erreur d'écriture.
+bool tmapWriteGrid(grid G, const char *file, int shift);
+
+
+// Convertit un fichier texte au format de initGridFile() en fichier
+// tuilé, sans jamais charger toute la grille: seules 2^shift lignes
+// sont en mémoire à la fois. Renvoie false en cas d'erreur.
+bool tmapConvertText(const char *txt, const char *file, int shift);
+
+#endif
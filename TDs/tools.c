@@ -1,4 +1,5 @@
 #include "tools.h"
+#include "terrain.h"
 
 
 ///////////////////////////////////////////////////////////////////////////
@@ -8,8 +9,8 @@
 //
 ///////////////////////////////////////////////////////////////////////////
 
-// nombres d'appels au dessin de la grille attendus par seconde
-static unsigned long call_speed = 1 << 7;
+// nombre d'images affichées par seconde (touches a et z)
+static int frame_rate = 50;
 
 static bool mouse_ldown = false; // bouton souris gauche, vrai si enfoncé
 static bool mouse_rdown = false; // boutons souris droit, vrai si enfoncé
@@ -23,8 +24,6 @@ static int mst = 3;              // pour drawGraph():
                                  // bit-1: dessin de la tournée (1=oui/0=non)
 static SDL_Window *window;
 static SDL_GLContext glcontext;
-static GLvoid *gridImage;
-static GLuint texName;
 
 static void drawLine(point p, point q) {
   glBegin(GL_LINES);
@@ -55,6 +54,160 @@ static void drawPoint(point p) {
   glEnd();
 }
 
+// Fonctions des tampons de sommets (OpenGL 1.5), chargées par
+// init_SDL_OpenGL(). Si elles ne sont pas disponibles, les sommets
+// sont envoyés depuis la mémoire centrale à chaque dessin.
+static PFNGLGENBUFFERSPROC pglGenBuffers;
+static PFNGLBINDBUFFERPROC pglBindBuffer;
+static PFNGLBUFFERDATAPROC pglBufferData;
+
+// Lot de sommets dessinés en un seul appel à glDrawArrays().
+typedef struct {
+  GLfloat *v;  // v[2i],v[2i+1] = coordonnées du sommet i
+  int n, nmax; // nombre de sommets
+  GLuint vbo;  // tampon sur la carte graphique (0 si pas encore créé)
+  bool sent;   // vrai ssi le tampon contient déjà v[]
+} vbatch;
+
+static void vbAdd(vbatch *B, double x, double y) {
+  if (B->n == B->nmax) {
+    B->nmax = B->nmax ? 2 * B->nmax : 256;
+    B->v = realloc(B->v, 2 * B->nmax * sizeof(*B->v));
+  }
+  B->v[2 * B->n] = x;
+  B->v[2 * B->n + 1] = y;
+  B->n++;
+  B->sent = false;
+}
+
+static void vbDraw(vbatch *B, GLenum mode) {
+  if (B->n == 0)
+    return;
+  glEnableClientState(GL_VERTEX_ARRAY);
+  if (pglBindBuffer) {
+    if (B->vbo == 0)
+      pglGenBuffers(1, &B->vbo);
+    pglBindBuffer(GL_ARRAY_BUFFER, B->vbo);
+    if (!B->sent)
+      pglBufferData(GL_ARRAY_BUFFER, 2 * B->n * sizeof(*B->v), B->v,
+                    GL_STATIC_DRAW);
+    B->sent = true;
+    glVertexPointer(2, GL_FLOAT, 0, NULL);
+  } else
+    glVertexPointer(2, GL_FLOAT, 0, B->v);
+  glDrawArrays(mode, 0, B->n);
+  if (pglBindBuffer)
+    pglBindBuffer(GL_ARRAY_BUFFER, 0);
+  glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+#define ORANGE .99,.8,.3
+
+// Copie de ce qu'il faut dessiner, publiée par les fonctions drawXXX()
+// et dessinée par le thread d'affichage (cf. snapPublish()). Chaque
+// copie possède ses tableaux, agrandis à la demande et réutilisés d'une
+// publication à l'autre.
+enum { SNAP_NONE, SNAP_GRID, SNAP_SCENE };
+typedef struct {
+  int kind;     // SNAP_NONE, SNAP_GRID ou SNAP_SCENE
+  unsigned seq; // numéro de la publication (1, 2, ...)
+
+  // pour SNAP_GRID: les cases ne sont pas copiées, le thread
+  // d'affichage les lit dans la grille (cf. drawGridTiles())
+  grid G;          // la grille, à la date de la publication
+  bool tracked;    // tileStamp[] suit les cases de G (cf. gridTouch())
+  unsigned gridId; // nombre de grilles allouées à la publication
+
+  // pour SNAP_SCENE
+  point *V; // copie de V[0..n-1]
+  int *P;   // copie de P[0..m-1], les cases utilisées par les arêtes
+  int *E;   // arêtes i<j du graphe, à plat
+  int n, m, ne;
+  int e;    // nombre d'arêtes de la tournée ou du chemin
+  GLfloat rgb[3]; // couleur de la tournée ou du chemin
+  size_t nV, nP, nE; // tailles allouées
+} snapshot;
+
+// Dessin de drawTour(), drawPath() ou drawGraph(). Les lots de sommets
+// ne sont reconstruits que si la copie ou l'orientation a changé depuis
+// le dessin précédent.
+typedef struct {
+  unsigned seq; // numéro de la copie dessinée
+  bool oriented;
+  vbatch line, thin, thick, dot, tree;
+} scene;
+
+// Dessine dans S les points, les e arêtes P[i]->P[(i+1)%n] et le graphe
+// de la copie C.
+static void drawScene(scene *S, const snapshot *C) {
+  const point *V = C->V;
+  const int *P = C->P;
+  const int n = C->n, e = C->e;
+
+  if (S->seq != C->seq || S->oriented != oriented) {
+    S->seq = C->seq, S->oriented = oriented;
+    S->line.n = S->thin.n = S->thick.n = S->dot.n = S->tree.n = 0;
+    S->line.sent = S->thin.sent = S->thick.sent = false;
+    S->dot.sent = S->tree.sent = false;
+    for (int k = 0; k < C->ne; k += 2) {
+      vbAdd(&S->tree, V[C->E[k]].x, V[C->E[k]].y);
+      vbAdd(&S->tree, V[C->E[k + 1]].x, V[C->E[k + 1]].y);
+    }
+    for (int i = 0; i < e; i++) {
+      const point p = V[P[i]], q = V[P[(i + 1) % n]];
+      if (oriented) { // flèche: le dernier 5e de l'arête est épais
+        const double x = .2 * p.x + .8 * q.x, y = .2 * p.y + .8 * q.y;
+        vbAdd(&S->thin, p.x, p.y), vbAdd(&S->thin, x, y);
+        vbAdd(&S->thick, x, y), vbAdd(&S->thick, q.x, q.y);
+      } else
+        vbAdd(&S->line, p.x, p.y), vbAdd(&S->line, q.x, q.y);
+    }
+    for (int i = 0; i < n; i++)
+      vbAdd(&S->dot, V[i].x, V[i].y);
+  }
+
+  // dessine G
+  if (S->tree.n) {
+    glLineWidth(5.0);
+    glColor3f(0, 0.4, 0); // Vert foncé
+    vbDraw(&S->tree, GL_LINES);
+    glLineWidth(1.0);
+  }
+
+  // dessine la tournée ou le chemin
+  if (e) {
+    glColor3f(C->rgb[0], C->rgb[1], C->rgb[2]);
+    if (oriented) {
+      GLfloat linewidth = 1;
+      glGetFloatv(GL_LINE_WIDTH, &linewidth);
+      vbDraw(&S->thin, GL_LINES);
+      glLineWidth(linewidth * 5);
+      vbDraw(&S->thick, GL_LINES);
+      glLineWidth(linewidth);
+    } else
+      vbDraw(&S->line, GL_LINES);
+    if (root && n > 1) {
+      glColor3f(ORANGE); // Orange
+      if (oriented)
+        drawEdge(V[P[0]], V[P[1]]);
+      else
+        drawLine(V[P[0]], V[P[1]]);
+    }
+  }
+
+  // dessine les points
+  if (n) {
+    glColor3f(1, 0, 0); // Rouge
+    glPointSize(5.0f);
+    vbDraw(&S->dot, GL_POINTS);
+    if (root && C->m > 0) {
+      glColor3f(ORANGE); // Orange
+      drawPoint(V[P[0]]);
+    }
+  }
+}
+#undef ORANGE
+
 // Convertit les coordonnées pixels en coordonnées dans le dessin
 static void pixelToCoord(int pixel_x, int pixel_y, double *x, double *y) {
   GLdouble ray_z;
@@ -82,18 +235,139 @@ static void getCenterCoord(double *x, double *y) {
                x, y);
 }
 
+// Index des points vertices[] pour getClosestVertex(): grille uniforme
+// de nx × ny cellules couvrant la boîte englobante des points au moment
+// de sa construction, avec environ deux points par cellule. Chaque
+// cellule est une liste doublement chaînée de ses points, si bien qu'un
+// point déplacé à la souris change de cellule en O(1) (cf. vxMove()).
+// Les points sortis de la boîte sont dans une liste à part, la cellule
+// numéro nx*ny, parcourue à chaque requête: au-delà de VX_OUT points,
+// l'index est reconstruit sur la nouvelle boîte.
+#define VX_OUT 64
+static struct {
+  double x0, y0;    // coin de la boîte
+  double cw, ch;    // dimensions d'une cellule
+  int nx, ny;       // nombre de cellules dans chaque direction
+  int *head;        // head[c] = premier point de la cellule c, ou -1
+  int *next, *prev; // point suivant et précédent dans sa cellule, ou -1
+  int *cell;        // cell[i] = cellule du point i
+  int n;            // nombre de points indexés
+  int nout;         // nombre de points hors de la boîte
+  bool valid;       // faux si vertices[] a changé (cf. generatePoints())
+} vx;
+
+// Cellule du point (x,y), ou nx*ny s'il est hors de la boîte.
+static int vxCell(double x, double y) {
+  const int a = floor((x - vx.x0) / vx.cw), b = floor((y - vx.y0) / vx.ch);
+  if (a < 0 || b < 0 || a >= vx.nx || b >= vx.ny)
+    return vx.nx * vx.ny;
+  return b * vx.nx + a;
+}
+
+static void vxInsert(int i, int c) {
+  vx.nout += (c == vx.nx * vx.ny);
+  vx.cell[i] = c;
+  vx.prev[i] = -1;
+  vx.next[i] = vx.head[c];
+  if (vx.head[c] >= 0)
+    vx.prev[vx.head[c]] = i;
+  vx.head[c] = i;
+}
+
+static void vxRemove(int i) {
+  const int c = vx.cell[i];
+  vx.nout -= (c == vx.nx * vx.ny);
+  if (vx.prev[i] >= 0)
+    vx.next[vx.prev[i]] = vx.next[i];
+  else
+    vx.head[c] = vx.next[i];
+  if (vx.next[i] >= 0)
+    vx.prev[vx.next[i]] = vx.prev[i];
+}
+
+// (Re)construit l'index des num_vertices points en O(n).
+static void vxBuild(void) {
+  const int n = num_vertices;
+  double x1 = vertices[0].x, y1 = vertices[0].y;
+  vx.x0 = x1, vx.y0 = y1;
+  for (int i = 1; i < n; i++) {
+    vx.x0 = fmin(vx.x0, vertices[i].x), x1 = fmax(x1, vertices[i].x);
+    vx.y0 = fmin(vx.y0, vertices[i].y), y1 = fmax(y1, vertices[i].y);
+  }
+  // cellules carrées de côté c, environ deux points par cellule
+  const double w = fmax(x1 - vx.x0, 1E-9), h = fmax(y1 - vx.y0, 1E-9);
+  const double c = sqrt(2 * w * h / n);
+  vx.nx = fmax(1, fmin(w / c, 2 * n)), vx.ny = fmax(1, fmin(h / c, 2 * n));
+  vx.cw = w / vx.nx * (1 + 1E-9), vx.ch = h / vx.ny * (1 + 1E-9);
+
+  const int nc = vx.nx * vx.ny + 1;
+  vx.head = realloc(vx.head, nc * sizeof(int));
+  vx.next = realloc(vx.next, n * sizeof(int));
+  vx.prev = realloc(vx.prev, n * sizeof(int));
+  vx.cell = realloc(vx.cell, n * sizeof(int));
+  for (int k = 0; k < nc; k++)
+    vx.head[k] = -1;
+  vx.nout = 0;
+  for (int i = n - 1; i >= 0; i--)
+    vxInsert(i, vxCell(vertices[i].x, vertices[i].y));
+  vx.n = n;
+  vx.valid = true;
+}
+
+// Met à jour l'index après le déplacement du point i en vertices[i].
+static void vxMove(int i) {
+  if (!vx.valid || i >= vx.n)
+    return;
+  const int c = vxCell(vertices[i].x, vertices[i].y);
+  if (c != vx.cell[i]) {
+    vxRemove(i);
+    vxInsert(i, c);
+  }
+  if (vx.nout > VX_OUT)
+    vx.valid = false;
+}
+
+// Parcourt les points de la cellule c et met à jour le plus proche
+// *best de (x,y), à distance² *dmin.
+static void vxScan(int c, double x, double y, int *best, double *dmin) {
+  for (int i = vx.head[c]; i >= 0; i = vx.next[i]) {
+    const double d = (x - vertices[i].x) * (x - vertices[i].x) +
+                     (y - vertices[i].y) * (y - vertices[i].y);
+    if (d < *dmin || (d == *dmin && i < *best))
+      *best = i, *dmin = d;
+  }
+}
+
 static int getClosestVertex(double x, double y) {
-  // renvoie l'indice i du point le plus proche de (x,y)
-  int res = 0;
-  double dmin = (x - vertices[0].x) * (x - vertices[0].x) +
-                (y - vertices[0].y) * (y - vertices[0].y);
-
-  for (int i = 1; i < num_vertices; i++) {
-    double dist = (x - vertices[i].x) * (x - vertices[i].x) +
-                  (y - vertices[i].y) * (y - vertices[i].y);
-    if (dist < dmin) {
-      dmin = dist;
-      res = i;
+  // renvoie l'indice i du point le plus proche de (x,y), ou -1 s'il n'y
+  // a pas de point
+  if (num_vertices <= 0 || vertices == NULL)
+    return -1;
+  if (!vx.valid || vx.n != num_vertices)
+    vxBuild();
+
+  int res = -1;
+  double dmin = DBL_MAX;
+  vxScan(vx.nx * vx.ny, x, y, &res, &dmin); // points hors de la boîte
+
+  // On parcourt les cellules par anneaux autour de la cellule (a,b) de
+  // la projection de (x,y) sur la boîte. Les points de la boîte hors
+  // des anneaux 0..r sont à distance au moins r*min(cw,ch) de cette
+  // projection, donc aussi de (x,y).
+  const int a = fmax(0, fmin(vx.nx - 1, floor((x - vx.x0) / vx.cw)));
+  const int b = fmax(0, fmin(vx.ny - 1, floor((y - vx.y0) / vx.ch)));
+  const double step = fmin(vx.cw, vx.ch);
+  const int rmax = (vx.nx > vx.ny) ? vx.nx : vx.ny;
+  for (int r = 0; r <= rmax; r++) {
+    if (res >= 0 && dmin <= (r - 1) * step * (r - 1) * step && r > 0)
+      break;
+    for (int j = b - r; j <= b + r; j++) {
+      if (j < 0 || j >= vx.ny)
+        continue;
+      const int di = (j == b - r || j == b + r) ? 1 : 2 * r; // bords haut et bas en entier
+      for (int i = a - r; i <= a + r; i += (r ? di : 1))
+        if (i >= 0 && i < vx.nx)
+          vxScan(j * vx.nx + i, x, y, &res, &dmin);
     }
   }
 
@@ -125,30 +399,6 @@ static void zoomMouse(double s){
   scale *= s;
 }
 
-// set drawGrid call speed
-void speedUp() {
-  if (!call_speed)
-    call_speed = 1;
-  if ((call_speed << 1) != 0)
-    call_speed <<= 1;
-}
-
-void speedDown() {
-  call_speed >>= 1;
-  if (!call_speed)
-    call_speed = 1;
-}
-
-void speedSet(unsigned long speed) {
-  call_speed = speed;
-  if (!call_speed)
-    call_speed = 1;
-}
-
-unsigned long speedMax() {
-  return ULONG_MAX;
-}
-
 
 static int NextPerm(int *P, const int n, const int *C) {
   /*
@@ -179,7 +429,7 @@ static int NextPerm(int *P, const int n, const int *C) {
     - n=9 et k=3, on a 216 permutations au lieu de 362.880 (k^n=19.683)
     - n=12 et k=3, on a 13.824 permutations au lieu de 479.001.600 (k^n=531.441)
 
-    Le dernier élément de C doit être égale à n-1 (sentinelle), le
+    Le dernier élément de C doit être égale à n (sentinelle), le
     premier étant omis car toujours = 0. Donc C est un tableau à au plus
     n éléments. Si C=NULL, alors il n'y a pas de contrainte
     particulière, ce qui est identique à poser C[0]=n.
@@ -282,99 +532,302 @@ static inline int inGrid(grid *G, position p) {
   return (0 <= p.x) && (p.x < G->X) && (0 <= p.y) && (p.y < G->Y);
 }
 
+// Suivi des cases modifiées (cf. gridTouch()): la grille est découpée
+// en tuiles de TILE x TILE cases. tileStamp[a*tileTY+b] = époque de la
+// dernière modification de la tuile (a,b); le thread d'affichage passe
+// à l'époque suivante à chaque image, si bien qu'une tuile modifiée
+// après avoir été lue a un tampon plus grand que celui de sa lecture.
+#define TILE 64
+
+static atomic_uint *tileStamp; // pour la dernière grille allouée
+static uint8_t **stampGrid;    // .value de cette grille
+static int tileTX, tileTY;     // nombre de tuiles dans chaque direction
+static bool tracked;           // vrai dès qu'une case a été signalée
+static unsigned gridCount;     // nombre de grilles allouées
+static unsigned snapSeq = 1;   // numéro de la prochaine publication
+static atomic_uint epoch = 1;  // époque courante (cf. drawGridTiles())
+
+// La grille dessinée ne doit pas être libérée pendant que le thread
+// d'affichage la lit: celui-ci prend gridLock pendant la lecture et ne
+// lit que si elle est encore liveGrid. freeGrid() et allocGrid() (qui
+// remplace tileStamp[]) prennent aussi gridLock.
+static SDL_SpinLock gridLock;
+static _Atomic(uint8_t **) liveGrid; // .value de la dernière grille publiée
+
+void gridTouch(int i, int j) {
+  const int a = i / TILE, b = j / TILE;
+  if (tileStamp == NULL || i < 0 || j < 0 || a >= tileTX || b >= tileTY)
+    return;
+  atomic_store_explicit(&tileStamp[a * tileTY + b],
+                        atomic_load_explicit(&epoch, memory_order_relaxed),
+                        memory_order_release);
+  tracked = true;
+}
+
+// Paramètres de la coloration d'une case qui ne dépendent pas de la
+// case: lut[m][v] est la couleur d'une case de marque m et de valeur v,
+// sauf si grad[m] où la couleur est un dégradé (cf. cellColor()).
+#define NC (sizeof(color) / sizeof(*color))
+typedef struct {
+  RGB lut[NC][NC];
+  bool grad[NC];
+  position s, t; // départ et destination
+  double dmax;   // distance entre s et t
+  double t2;     // avancement de l'effacement du dégradé
+} palette;
+
+static inline RGB cellColor(grid *G, const palette *P, int i, int j) {
+  int m = G->mark[i][j], v = G->value[i][j];
+  if (m >= NCOLOR)
+    m = M_NULL;
+  if (v >= NCOLOR)
+    v = V_FREE;
+  if (!P->grad[m])
+    return P->lut[m][v];
+
+  // interpolation de couleur entre les couleurs M_USED(2) et C_FINAL(2)
+  // ou bien M_USED(2) et v si on est en train de reconstruire le chemin
+  const position p = {.x = i, .y = j};
+  double t1 = distLmax((m == M_USED) ? P->s : P->t, p) / P->dmax;
+  t1 = fmax(t1, 0.0), t1 = fmin(t1, 1.0);
+  const double t2 = P->t2;
+  const int f = (m == M_USED) ? C_FINAL : C_FINAL2;
+  RGB c;
+  c.R = t2*color[v].R + (1-t2) * (t1 * color[f].R + (1-t1)*color[m].R);
+  c.G = t2*color[v].G + (1-t2) * (t1 * color[f].G + (1-t1)*color[m].G);
+  c.B = t2*color[v].B + (1-t2) * (t1 * color[f].B + (1-t1)*color[m].B);
+  return c;
+}
+
+// Dessin de la grille par tuiles de textures. Au niveau de détail L,
+// un texel représente 2^L x 2^L cases (la case centrale est prise comme
+// échantillon) et une tuile 2^texBits x 2^texBits texels. Seules les
+// tuiles visibles au niveau adapté au zoom sont coloriées et envoyées,
+// dans un ensemble de NTEX textures réutilisées (la moins récemment
+// dessinée est remplacée). La mémoire est ainsi bornée quelle que soit
+// la taille de la grille, et aucune texture ne dépasse
+// GL_MAX_TEXTURE_SIZE.
+#define NTEX 128
+
+typedef struct {
+  GLuint name;    // texture (0 = pas encore créée)
+  uint8_t **grid; // clé: grille (.value et numéro), niveau et tuile (a,b)
+  unsigned id;
+  int L, a, b;
+  unsigned ver;   // époque jusqu'à laquelle les cases sont à jour
+  unsigned pal;   // numéro de la palette utilisée
+  unsigned used;  // dernière image où la tuile a été dessinée
+} ttile;
+
+static ttile texTile[NTEX];
+static int texBits = 8;  // côté des tuiles: 2^texBits texels
+static RGB *tileRGB;     // texels de la tuile en cours de coloriage
+
+// Renvoie la texture de la tuile (L,a,b) de la grille de C, en
+// recyclant au besoin la moins récemment dessinée (*fresh devient vrai).
+static ttile *tileGet(const snapshot *C, int L, int a, int b, bool *fresh) {
+  ttile *t = texTile;
+  for (int k = 0; k < NTEX; k++) {
+    ttile *u = texTile + k;
+    if (u->name && u->grid == C->G.value && u->id == C->gridId &&
+        u->L == L && u->a == a && u->b == b) {
+      *fresh = false;
+      return u;
+    }
+    if (u->used < t->used)
+      t = u;
+  }
+  if (t->name == 0) { // texture allouée une seule fois
+    const int T = 1 << texBits;
+    glGenTextures(1, &t->name);
+    glBindTexture(GL_TEXTURE_2D, t->name);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, T, T, 0, GL_RGB,
+                 GL_UNSIGNED_BYTE, NULL);
+  }
+  t->grid = C->G.value, t->id = C->gridId;
+  t->L = L, t->a = a, t->b = b;
+  *fresh = true;
+  return t;
+}
+
+// Époque de la dernière modification des cases de la tuile (L,a,b):
+// plus grand tampon des tuiles de suivi qu'elle recouvre, ou UINT_MAX
+// si les cases de la grille ne sont pas suivies.
+static unsigned tileVersion(const snapshot *C, int L, int a, int b) {
+  if (!C->tracked || tileStamp == NULL)
+    return UINT_MAX;
+  const long S = 1L << (texBits + L); // cases par côté de la tuile
+  const int i0 = a * S / TILE, i1 = fmin(tileTX, ((a + 1) * S + TILE - 1) / TILE);
+  const int j0 = b * S / TILE, j1 = fmin(tileTY, ((b + 1) * S + TILE - 1) / TILE);
+  unsigned v = 0;
+  for (int i = i0; i < i1; i++)
+    for (int j = j0; j < j1; j++) {
+      const unsigned w = atomic_load_explicit(&tileStamp[i * tileTY + j],
+                                              memory_order_acquire);
+      if (w > v)
+        v = w;
+    }
+  return v;
+}
+
+// Colorie dans tileRGB[] la tuile (L,a,b) de G.
+static void colorTile(grid *G, const palette *P, int L, int a, int b) {
+  const int T = 1 << texBits, S = T << L, h = (1 << L) / 2;
+  #pragma omp parallel for schedule(static)
+  for (int x = 0; x < T; x++) {
+    const int i = fmin(G->X - 1, a * S + (x << L) + h);
+    for (int y = 0; y < T; y++) {
+      const int j = fmin(G->Y - 1, b * S + (y << L) + h);
+      tileRGB[y * T + x] = cellColor(G, P, i, j);
+    }
+  }
+
+  // le départ et la destination colorient le texel qui les contient
+  position p[2] = {G->start, G->end};
+  for (int k = 0; k < 2; k++)
+    if (inGrid(G, p[k]) && p[k].x / S == a && p[k].y / S == b) {
+      int c = k ? C_END : C_START;
+      if (k && G->value[p[k].x][p[k].y] == V_WALL)
+        c = C_END_WALL;
+      tileRGB[((p[k].y - b * S) >> L) * T + ((p[k].x - a * S) >> L)] = color[c];
+    }
+}
+
 //
-// Construit l'image (pixels) de la grille à partir de la grille G. Le
-// point (0,0) de G correspond au coin en haut à gauche.
+// Met à jour et dessine les tuiles visibles de la grille publiée dans
+// C. Le point (0,0) de G correspond au coin en haut à gauche.
 //
 // +--x
 // |
 // y
 //
-static void makeImage(grid *G) {
+// Une tuile n'est recoloriée et envoyée que si elle est nouvelle, si
+// l'une de ses cases a été signalée par gridTouch() depuis son dernier
+// coloriage, si aucune case n'a jamais été signalée, ou si un paramètre
+// global de la coloration a changé (départ, destination, fin du chemin,
+// effacement). Les cases sont lues dans la grille elle-même, sans
+// copie: une image peut montrer une case modifiée pendant sa lecture,
+// corrigée à l'image suivante.
+//
+static void drawGridTiles(snapshot *C) {
   static int cpt; // compteur d'étape lorsqu'on reconstruit le chemin
+  static palette P0; // palette de l'image précédente
+  static unsigned pal; // numéro de P0
+  static unsigned frame; // numéro de l'image
+
+  grid *G = &C->G;
+  const int T = 1 << texBits;
+  frame++;
+  SDL_AtomicLock(&gridLock);
+  if (G->value != atomic_load(&liveGrid)) { // grille libérée
+    SDL_AtomicUnlock(&gridLock);
+    return;
+  }
 
-  RGB *I = gridImage, c;
-  int k = 0, v, m, f;
+  // le chemin est construit depuis la destination jusqu'au départ
   int fin = (G->mark[G->start.x][G->start.y] ==
              M_PATH && G->mark[G->end.x][G->end.y] ==
              M_PATH); // si le chemin a fini d'être construit (les deux sont marqués)
+  int debut = (G->mark[G->start.x][G->start.y] == M_PATH ||
+               G->mark[G->end.x][G->end.y] == M_PATH); // s'il a commencé
 
-  int debut=0; // vrai ssi le chemin commence à être construit
-  for (int j = 0; j < G->Y && !debut; j++)
-    for (int i = 0; i < G->X && !debut; i++)
-      if(G->mark[i][j]==M_PATH) debut=1;
-  
-  if (fin)
-    update = false;
   if (debut == 0)
     cpt = 0;
   if (debut)
     cpt++;
-  if (debut && cpt == 1) {
-    speedSet(sqrt(call_speed/4));
-  }
-
-  double t1,t2,dmax = distLmax(G->start, G->end);
-  if (dmax == 0) dmax = 1E-10; // pour éviter la division par 0
-
-  for (int j = 0; j < G->Y; j++)
-    for (int i = 0; i < G->X; i++) {
-      m = G->mark[i][j];
-      if ((m < 0) || (m >= NCOLOR))
-        m = M_NULL;
-      v = G->value[i][j];
-      if ((v < 0) || (v >= NCOLOR))
-        v = V_FREE;
-      do {
-        if (m == M_PATH) {
-          c = color[m];
-          break;
-        }
-        if (fin && erase) {
-          c = color[v];
-          break;
-        } // affiche la grille d'origine à la fin
-        if (m == M_NULL) {
-          c = color[v];
-          break;
-        } // si pas de marquage
-        if (m == M_USED || m == M_USED2) {
-          // interpolation de couleur entre les couleurs M_USED(2) et
-          // C_FINAL(2) ou bien M_USED(2) et v si on est en train de
-          // reconstruire le chemin
-          position p = {.x = i, .y = j};
-	  t1 = (m == M_USED) ? distLmax(G->start, p) / dmax : distLmax(G->end, p) / dmax;
-          t1 = fmax(t1, 0.0), t1 = fmin(t1, 1.0);
-          t2 = (debut && erase)? 0.5 * cpt / dmax : 0;
-          t2 = fmin(t2, 1.0);
-	  f = (m == M_USED) ? C_FINAL : C_FINAL2;
-          c.R = t2*color[v].R + (1-t2) * (t1 * color[f].R + (1-t1)*color[m].R);
-          c.G = t2*color[v].G + (1-t2) * (t1 * color[f].G + (1-t1)*color[m].G);
-          c.B = t2*color[v].B + (1-t2) * (t1 * color[f].B + (1-t1)*color[m].B);
-          break;
-        }
-        c = (m == M_NULL) ? color[v] : color[m];
-        break;
-      } while (0);
-      I[k++] = c;
-    }
 
-  if (inGrid(G, G->start)) {
-    k = G->start.y * G->X + G->start.x;
-    I[k] = color[C_START];
+  palette P;
+  memset(&P, 0, sizeof(P)); // comparée octet par octet à P0
+  P.s = G->start, P.t = G->end;
+  P.dmax = distLmax(G->start, G->end);
+  if (P.dmax == 0) P.dmax = 1E-10; // pour éviter la division par 0
+  P.t2 = (debut && erase)? fmin(0.5 * cpt / P.dmax, 1.0) : 0;
+  for (int m = 0; m < NCOLOR; m++) {
+    P.grad[m] = (m == M_USED || m == M_USED2) && !(fin && erase);
+    for (int v = 0; v < NCOLOR; v++)
+      if (m == M_PATH) P.lut[m][v] = color[m];
+      else if (fin && erase) P.lut[m][v] = color[v]; // grille d'origine à la fin
+      else if (m == M_NULL) P.lut[m][v] = color[v];  // si pas de marquage
+      else P.lut[m][v] = color[m];
   }
-
-  if (inGrid(G, G->end)) {
-    v = (G->value[G->end.x][G->end.y] == V_WALL) ? C_END_WALL : C_END;
-    k = G->end.y * G->X + G->end.x;
-    I[k] = color[v];
+  if (memcmp(&P, &P0, sizeof(P)))
+    P0 = P, pal++;
+
+  // niveau de détail: un texel fait au moins un pixel
+  int L = 0;
+  const int M = (G->X > G->Y) ? G->X : G->Y;
+  while (scale * (1 << L) < 1 && (T << L) < M)
+    L++;
+  const int S = T << L; // cases par côté d'une tuile
+
+  // cases visibles, d'après les coins de la fenêtre
+  double xmin = DBL_MAX, ymin = DBL_MAX, xmax = -DBL_MAX, ymax = -DBL_MAX;
+  for (int k = 0; k < 4; k++) {
+    double x, y;
+    pixelToCoord((k & 1) ? width : 0, (k & 2) ? height : 0, &x, &y);
+    xmin = fmin(xmin, x), xmax = fmax(xmax, x);
+    ymin = fmin(ymin, y), ymax = fmax(ymax, y);
   }
+  const int a0 = fmax(0, floor(xmin / S)), a1 = fmin((G->X - 1) / S, floor(xmax / S));
+  const int b0 = fmax(0, floor(ymin / S)), b1 = fmin((G->Y - 1) / S, floor(ymax / S));
+
+  // nouvelle époque: une case signalée à partir d'ici a un tampon > N-1
+  const unsigned N = atomic_fetch_add(&epoch, 1) + 1;
+  if (tileRGB == NULL)
+    tileRGB = malloc(T * T * sizeof(*tileRGB));
+
+  glEnable(GL_TEXTURE_2D);
+  glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_DECAL);
+  for (int a = a0; a <= a1; a++)
+    for (int b = b0; b <= b1; b++) {
+      bool fresh;
+      ttile *t = tileGet(C, L, a, b, &fresh);
+      const unsigned v = tileVersion(C, L, a, b);
+      glBindTexture(GL_TEXTURE_2D, t->name);
+      if (fresh || v > t->ver || t->pal != pal) {
+        colorTile(G, &P0, L, a, b);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, T, T, GL_RGB,
+                        GL_UNSIGNED_BYTE, tileRGB);
+        // une case signalée pendant l'époque N-1 a pu être lue avant
+        // d'être modifiée: la tuile sera relue à l'image suivante
+        t->ver = (v < N - 2) ? v : N - 2;
+        t->pal = pal;
+      }
+      t->used = frame;
+
+      // la tuile s'arrête au bord de la grille
+      const int x0 = a * S, x1 = fmin(G->X, x0 + S);
+      const int y0 = b * S, y1 = fmin(G->Y, y0 + S);
+      const double s1 = (double)(x1 - x0) / S, t1 = (double)(y1 - y0) / S;
+      glBegin(GL_QUADS);
+      glTexCoord2f(0.0, 0.0);
+      glVertex3f(x0, y0, 0);
+      glTexCoord2f(0.0, t1);
+      glVertex3f(x0, y1, 0);
+      glTexCoord2f(s1, t1);
+      glVertex3f(x1, y1, 0);
+      glTexCoord2f(s1, 0.0);
+      glVertex3f(x1, y0, 0);
+      glEnd();
+    }
+  glDisable(GL_TEXTURE_2D);
+  SDL_AtomicUnlock(&gridLock);
 }
+#undef NC
 
 //
 // Alloue une grille aux dimensions x,y ainsi que son image. On force
 // x,y>=3 pour avoir au moins un point qui n'est pas sur le bord.
 //
+// Les champs .value et .mark sont deux moitiés d'un même bloc de
+// 2*(x+2)*(y+2) octets, bord sentinelle compris (cf. tools.h). Les
+// pointeurs de colonnes, décalés d'une case, permettent de garder
+// l'écriture G.value[i][j].
+//
 static grid allocGrid(int x, int y) {
   grid G;
   position p = {-1, -1};
@@ -385,59 +838,52 @@ static grid allocGrid(int x, int y) {
     y = 3;
   G.X = x;
   G.Y = y;
-  G.value = malloc(x * sizeof(*(G.value)));
-  G.mark = malloc(x * sizeof(*(G.mark)));
+  G.stride = y + 2;
 
-  for (int i = 0; i < x; i++) {
-    G.value[i] = malloc(y * sizeof(*(G.value[i])));
-    G.mark[i] = malloc(y * sizeof(*(G.mark[i])));
-    for (int j = 0; j < y; j++)
-      G.mark[i][j] = M_NULL; // initialise
-  }
+  const size_t n = (size_t)(x + 2) * G.stride; // cases avec le bord
+  uint8_t *B = malloc(2 * n);
+  memset(B, V_WALL, n);     // .value: le bord reste V_WALL
+  memset(B + n, M_NULL, n); // .mark: initialise
 
-  gridImage = malloc(3 * x * y * sizeof(GLubyte));
+  uint8_t **C = malloc(2 * (x + 2) * sizeof(*C));
+  for (int i = 0; i < x + 2; i++) {
+    C[i] = B + (size_t)i * G.stride + 1;
+    C[x + 2 + i] = B + n + (size_t)i * G.stride + 1;
+  }
+  G.value = C + 1;
+  G.mark = C + x + 3;
+
+  for (int k = 0; k < 8; k++)
+    G.nbr[k] = nbr_dx[k] * G.stride + nbr_dy[k];
+
+  // suivi des cases modifiées pour drawGrid()
+  SDL_AtomicLock(&gridLock); // tileStamp[] peut être en lecture
+  free(tileStamp);
+  tileTX = (x + TILE - 1) / TILE, tileTY = (y + TILE - 1) / TILE;
+  tileStamp = calloc(tileTX * tileTY, sizeof(*tileStamp));
+  stampGrid = G.value;
+  tracked = false;
+  gridCount++;
+  SDL_AtomicUnlock(&gridLock);
   return G;
 }
 
 //
 // Renvoie une position aléatoire de la grille qui est uniforme parmi
 // toutes les valeurs de la grille du type t (hors les bords de la
-// grille). Si aucune case de type t n'est pas trouvée, la position
-// (-1,-1) est renvoyée.
+// grille). On tire une case au hasard jusqu'à tomber sur le type t, ce
+// qui est uniforme et coûte O(1) en moyenne dès que le type t n'est pas
+// rare. Après 64 échecs, la position (-1,-1) est renvoyée: c'est alors
+// à l'appelant de construire un index terrainCreate() (cf. terrain.h)
+// et de tirer avec terrainRandom(), en O(1) pour les tirages suivants.
 //
-static position randomPosition(grid G, int t) {
-  int i, j, c;
-  int n;                      // n=nombre de cases de type t hors le bord
-  int r = -1;                 // r=numéro aléatoire dans [0,n[
-  position p = {-1, -1};      // position par défaut
-  const int stop = G.X * G.Y; // pour sortir des boucles
-  const int x1 = G.X - 1;
-  const int y1 = G.Y - 1;
-
-  // On fait deux parcours: un 1er pour compter le nombre n de cases
-  // de type t, et un 2e pour tirer au hasard la position parmi les
-  // n. A la fin du premier parcours on connaît le nombre n de cases
-  // de type t. On tire alors au hasard un numéro r dans [0,n[. Puis
-  // on recommence le comptage (n=0) de cases de type t et on s'arrête
-  // dès qu'on arrive à la case numéro r.
-
-  c = 0;
-  do {
-    n = 0;
-    for (i = 1; i < x1; i++)
-      for (j = 1; j < y1; j++)
-        if (G.value[i][j] == t) {
-          if (n == r)
-            p.x = i, p.y = j,
-            i = j = stop; // toujours faux
-                          // au 1er parcours
-          n++;
-        }
-    c = 1 - c;
-    if (c)
-      r = random() % n;
-  } while (c); // vrai la 1ère fois, faux la 2e
-
+static position randomPosition(grid G, int t, rng *R) {
+  position p = {-1, -1}; // position par défaut
+  for (int k = 0; k < 64; k++) {
+    const int i = 1 + rngBelow(R, G.X - 2), j = 1 + rngBelow(R, G.Y - 2);
+    if (G.value[i][j] == t)
+      return p.x = i, p.y = j, p;
+  }
   return p;
 }
 
@@ -454,119 +900,31 @@ static position randomPosition(grid G, int t) {
 int    width   = 640;
 int    height  = 480;
 bool   update  = true;
-bool   running = true;
+_Atomic bool running = true;
 bool   hover   = true;
 bool   erase   = true;
 double scale   = 1;
 
-char *TopChrono(const int i) {
-#define CHRONOMAX 10
-  /*
-    Met à jour le chronomètre interne numéro i (i=0..CHRNONMAX-1) et
-    renvoie sous forme de char* le temps écoulé depuis le dernier appel
-    à la fonction pour le même chronomètre. La précision dépend du temps
-    mesuré. Il varie entre la seconde et le 1/1000 de seconde. Plus
-    précisément le format est le suivant:
-
-    1d00h00'  si le temps est > 24h (précision: 1')
-    1h00'00"  si le temps est > 60' (précision: 1s)
-    1'00"0    si le temps est > 1'  (précision: 1/10s)
-    1"00      si le temps est > 1"  (précision: 1/100s)
-    0"000     si le temps est < 1"  (précision: 1/1000s)
-
-    Pour initialiser et mettre à jour tous les chronomètres (dont le
-    nombre vaut CHRONOMAX), il suffit d'appeler une fois la fonction,
-    par exemple avec TopChrono(0). Si i<0, alors les pointeurs alloués
-    par l'initialisation sont désalloués. La durée maximale est limitée
-    à 100 jours. Si une erreur se produit (durée supérieure ou erreur
-    avec gettimeofday()), alors on renvoie la chaîne "--error--".
-  */
-  if (i >= CHRONOMAX)
-    return "--error--";
-
-  /* variables globales, locale à la fonction */
-  static int first =
-      1; /* =1 ssi c'est la 1ère fois qu'on exécute la fonction */
-  static char *str[CHRONOMAX];
-  static struct timeval last[CHRONOMAX], tv;
-  int j;
-
-  if (i < 0) {  /* libère les pointeurs */
-    if (!first) /* on a déjà alloué les chronomètres */
-      for (j = 0; j < CHRONOMAX; j++)
-        free(str[j]);
-    first = 1;
-    return NULL;
-  }
-
-  /* tv=temps courant */
-  int err = gettimeofday(&tv, NULL);
-
-  if (first) { /* première fois, on alloue puis on renvoie TopChrono(i) */
-    first = 0;
-    for (j = 0; j < CHRONOMAX; j++) {
-      str[j] = malloc(
-          10); // assez grand pour "--error--", "99d99h99'" ou "23h59'59""
-      last[j] = tv;
-    }
-  }
-
-  /* t=temps en 1/1000" écoulé depuis le dernier appel à TopChrono(i) */
-  long t = (tv.tv_sec - last[i].tv_sec) * 1000L +
-           (tv.tv_usec - last[i].tv_usec) / 1000L;
-  last[i] = tv; /* met à jour le chrono interne i */
-  if ((t < 0L) || (err))
-    t = LONG_MAX; /* temps erroné */
-
-  /* écrit le résultat dans str[i] */
-  for (;;) { /* pour faire un break */
-    /* ici t est en millième de seconde */
-    if (t < 1000L) { /* t<1" */
-      sprintf(str[i], "0\"%03li", t);
-      break;
-    }
-    t /= 10L;        /* t en centième de seconde */
-    if (t < 6000L) { /* t<60" */
-      sprintf(str[i], "%li\"%02li", t / 100L, t % 100L);
-      break;
-    }
-    t /= 10L;         /* t en dixième de seconde */
-    if (t < 36000L) { /* t<1h */
-      sprintf(str[i], "%li'%02li\"%li", t / 360L, (t / 10L) % 60L, t % 10L);
-      break;
-    }
-    t /= 10L;         /* t en seconde */
-    if (t < 86400L) { /* t<24h */
-      sprintf(str[i], "%lih%02li'%02li\"", t / 3600L, (t / 60L) % 60L, t % 60L);
-      break;
-    }
-    t /= 60L;         /* t en minute */
-    if (t < 144000) { /* t<100 jours */
-      sprintf(str[i], "%lid%02lih%02li'", t / 1440L, (t / 60L) % 24L, t % 60L);
-      break;
-    }
-    /* error ... */
-    sprintf(str[i], "--error--");
-  }
-
-  return str[i];
-#undef CHRONOMAX
-}
-
 bool NextPermutation(int *P, const int n) {
   return ( NextPerm(P, n, NULL) == 1 ); };
 
+bool NextConstrainedPermutation(int *P, const int n, const int *C) {
+  return ( NextPerm(P, n, C) == 1 ); }
+
 //
 // Libère les pointeurs alloués par allocGrid().
 //
 void freeGrid(grid G) {
-  for (int i = 0; i < G.X; i++) {
-    free(G.value[i]);
-    free(G.mark[i]);
+  SDL_AtomicLock(&gridLock); // attend que l'affichage ne lise plus G
+  if (atomic_load(&liveGrid) == G.value)
+    atomic_store(&liveGrid, NULL);
+  if (stampGrid == G.value) {
+    free(tileStamp);
+    tileStamp = NULL, stampGrid = NULL;
   }
-  free(G.value);
-  free(G.mark);
-  free(gridImage);
+  SDL_AtomicUnlock(&gridLock);
+  free(G.value[-1] - 1); // début du bloc
+  free(G.value - 1);     // début des pointeurs de colonnes
 }
 
 //
@@ -574,28 +932,155 @@ void freeGrid(grid G) {
 // type et de densité donnés. Le départ et la destination sont
 // initialisées aléatroirement dans une case V_FREE.
 //
-grid initGridPoints(int x, int y, int type, double density) {
-#define RAND01 ((double)random() / RAND_MAX) // réel aléatoire dans [0,1[
+grid initGridPoints(int x, int y, int type, double density, rng *R) {
   grid G = allocGrid(x, y); // alloue la grille et son image
+  x = G.X, y = G.Y;
 
   // vérifie que le type est correct, M_NULL par défaut
   if ((type < 0) || (type >= NCOLOR))
     type = M_NULL;
 
-  // met les bords et remplit l'intérieur
-  for (int i = 0; i < x; i++)
-    for (int j = 0; j < y; j++)
-      G.value[i][j] =
-          onBorder(&G, i, j) ? V_WALL : ((RAND01 <= density) ? type : V_FREE);
-
-  // position start/end aléatoires
-  G.start = randomPosition(G, V_FREE);
-  G.end = randomPosition(G, V_FREE);
+  // met les bords et remplit l'intérieur, par blocs de 64 colonnes
+  // ayant chacun leur flot aléatoire
+  const int nc = (x + 63) / 64;
+  rng *S = malloc(nc * sizeof(*S));
+  rngStreams(R, S, nc);
+  #pragma omp parallel for schedule(dynamic)
+  for (int c = 0; c < nc; c++) {
+    double *U = malloc(y * sizeof(*U));
+    for (int i = 64 * c; i < x && i < 64 * (c + 1); i++) {
+      rngFill(S + c, U, y);
+      for (int j = 0; j < y; j++)
+        G.value[i][j] =
+            onBorder(&G, i, j) ? V_WALL : ((U[j] <= density) ? type : V_FREE);
+    }
+    free(U);
+  }
+  free(S);
+
+  // position start/end aléatoires, par l'index des terrains (construit
+  // une seule fois) si les cases V_FREE sont trop rares pour le rejet
+  G.start = randomPosition(G, V_FREE, R);
+  G.end = randomPosition(G, V_FREE, R);
+  if (G.start.x < 0 || G.end.x < 0) {
+    terrain T = terrainCreate(G);
+    G.start = terrainRandom(&T, 1 << V_FREE, R);
+    G.end = terrainRandom(&T, 1 << V_FREE, R);
+    terrainFree(T);
+  }
 
-#undef RAND01
   return G;
 }
 
+// Ajoute au labyrinthe le passage entre les cellules voisines u et v
+// d'une région de hauteur y dont la cellule locale (a,b) est la
+// cellule (ox+a,oy+b) du labyrinthe de hauteur Y (cf. wilson()).
+static inline void carve(uint8_t *open, int Y, int ox, int oy, int y, int u,
+                         int v) {
+  if (v < u) {
+    int t = u;
+    u = v, v = t;
+  }
+  open[(size_t)(ox + u / y) * Y + oy + u % y] |= (v - u == y) ? 1 : 2;
+}
+
+// Arbre couvrant aléatoire uniforme de la région de x*y cellules par
+// l'algorithme de Wilson. Les passages sont ajoutés dans open[] (bit 1
+// vers la cellule (i+1,j), bit 2 vers (i,j+1)), cf. carve(). Le
+// tableau de travail value[] de x*y entiers contient -1 pour une
+// cellule libre, 0 pour une cellule de l'arbre et k>0 pour une cellule
+// de la marche courante dont la précédente est k-1.
+//
+// Les cellules avant le curseur c sont toutes dans l'arbre, c n'a donc
+// jamais à revenir en arrière et la recherche de la prochaine cellule
+// libre coûte O(x*y) au total. Il faut x*y <= INT_MAX.
+static void wilson(int x, int y, int *value, uint8_t *open, int ox, int oy,
+                   int Y, rng *R) {
+  const int n = x * y;
+  for (int k = 0; k < n; k++)
+    value[k] = -1;
+  value[0] = 0;
+
+  uint64_t bits = 0; // réserve de directions aléatoires (2 bits chacune)
+  int nb = 0, count = 1, c = 0;
+  while (count < n) {
+    while (value[c] != -1)
+      c++;
+    int i0 = c;
+    value[i0] = i0 + 1;
+    while (true) {
+      int x0 = i0 / y, y0 = i0 % y;
+      while (true) {
+        if (nb == 0)
+          bits = rngNext(R), nb = 32;
+        int dir = bits & 3;
+        bits >>= 2, nb--;
+        if (dir == 0 && x0 > 0) { x0--; break; }
+        if (dir == 1 && y0 > 0) { y0--; break; }
+        if (dir == 2 && x0 < x - 1) { x0++; break; }
+        if (dir == 3 && y0 < y - 1) { y0++; break; }
+      }
+      const int i1 = x0 * y + y0;
+      if (value[i1] == -1) { // cellule libre: on avance
+        value[i1] = i0 + 1;
+        i0 = i1;
+        continue;
+      }
+      if (value[i1] > 0) { // boucle: on l'efface jusqu'à i1
+        while (i0 != i1) {
+          int p = value[i0] - 1;
+          value[i0] = -1;
+          i0 = p;
+        }
+        continue;
+      }
+      // i1 est dans l'arbre: on y ajoute toute la marche
+      for (int v = i1;;) {
+        carve(open, Y, ox, oy, y, i0, v);
+        int p = value[i0] - 1;
+        value[i0] = 0;
+        count++;
+        if (p == i0)
+          break; // début de la marche
+        v = i0, i0 = p;
+      }
+      break;
+    }
+  }
+}
+
+// Construit en une seule passe la grille du labyrinthe x,y de couloirs
+// de largeur w dont les passages sont donnés par open[] (cf. wilson()).
+static grid labyGrid(int x, int y, int w, const uint8_t *open) {
+  grid Gw = allocGrid(x * (w + 1) + 1, y * (w + 1) + 1);
+
+  // position par défaut
+  Gw.start.x = Gw.X - 2;
+  Gw.start.y = Gw.Y - 2;
+  Gw.end.x = 1;
+  Gw.end.y = 1;
+
+  // les murs sont sur les lignes multiples de w+1, sauf aux passages
+  #pragma omp parallel for
+  for (int i = 0; i < Gw.X; i++) {
+    const int a = i / (w + 1), ri = i % (w + 1);
+    for (int j = 0; j < Gw.Y; j++) {
+      const int b = j / (w + 1), rj = j % (w + 1);
+      bool pass;
+      if (ri && rj)
+        pass = true;
+      else if (ri) // entre les cellules (a,b-1) et (a,b)
+        pass = (b > 0 && b < y && (open[(size_t)a * y + b - 1] & 2));
+      else if (rj) // entre les cellules (a-1,b) et (a,b)
+        pass = (a > 0 && a < x && (open[(size_t)(a - 1) * y + b] & 1));
+      else
+        pass = false;
+      Gw.value[i][j] = pass ? V_FREE : V_WALL;
+    }
+  }
+  return Gw;
+}
+
 //
 // Renvoie une grille aléatoire de dimensions x,y (au moins 3)
 // correspondant à partir un labyrinthe qui est un arbre couvrant
@@ -605,7 +1090,7 @@ grid initGridPoints(int x, int y, int type, double density) {
 // Il s'agit de l'algorithme de Wilson par "marches aléatoires avec
 // effacement de boucle" (cf. https://bl.ocks.org/mbostock/11357811)
 //
-grid initGridLaby(int x, int y, int w) {
+grid initGridLaby(int x, int y, int w, rng *R) {
 
   // vérifie les paramètres
   if (x < 3)
@@ -615,111 +1100,103 @@ grid initGridLaby(int x, int y, int w) {
   if (w <= 0)
     w = 1;
 
-  // alloue la grille et son image
-  int *value = malloc(x * y * sizeof(*value));
+  // wilson() numérote les cellules par des int: au-delà, on passe par
+  // les tuiles
+  if ((size_t)x * y > INT_MAX)
+    return initGridLabyTiled(x, y, w, 0, R);
 
-  // alloue la grille et son image
-  grid Gw = allocGrid(x * (w + 1) + 1, y * (w + 1) + 1);
+  int *value = malloc((size_t)x * y * sizeof(*value));
+  uint8_t *open = calloc((size_t)x * y, 1);
+  wilson(x, y, value, open, 0, 0, y, R);
+  free(value);
 
-  // position par défaut
-  Gw.start.x = Gw.X - 2;
-  Gw.start.y = Gw.Y - 2;
-  Gw.end.x = 1;
-  Gw.end.y = 1;
+  grid Gw = labyGrid(x, y, w, open);
+  free(open);
+  return Gw;
+}
 
-  // au début des murs seulement sur les bords
-  for (int i = 0; i < Gw.X; i++) {
-    for (int j = 0; j < Gw.Y; j++) {
-      Gw.value[i][j] =
-          ((i % (w + 1) == 0) || (j % (w + 1) == 0)) ? V_WALL : V_FREE;
+//
+// Comme initGridLaby(), mais pour de très grands labyrinthes: les
+// tuiles de b x b cellules sont générées en parallèle (un flot de R par
+// tuile, cf. rngStreams()), puis recollées selon un arbre couvrant
+// aléatoire des tuiles en ouvrant un passage au hasard sur chaque
+// frontière choisie. Le résultat est toujours un arbre couvrant, mais
+// plus uniforme à l'échelle des tuiles. Il ne dépend pas du nombre de
+// threads.
+//
+grid initGridLabyTiled(int x, int y, int w, int b, rng *R) {
+
+  // vérifie les paramètres
+  if (x < 3)
+    x = 3;
+  if (y < 3)
+    y = 3;
+  if (w <= 0)
+    w = 1;
+  if (b <= 0)
+    b = 256;
+
+  const int TX = (x + b - 1) / b, TY = (y + b - 1) / b;
+  rng *S = malloc((size_t)TX * TY * sizeof(*S)); // un flot par tuile
+  rngStreams(R, S, TX * TY);
+  uint8_t *open = calloc((size_t)x * y, 1);
+
+  #pragma omp parallel
+  {
+    int *value = malloc((size_t)b * b * sizeof(*value));
+    #pragma omp for schedule(dynamic)
+    for (int t = 0; t < TX * TY; t++) {
+      const int ox = (t / TY) * b, oy = (t % TY) * b;
+      const int bx = (x - ox < b) ? x - ox : b, by = (y - oy < b) ? y - oy : b;
+      wilson(bx, by, value, open, ox, oy, y, S + t);
     }
+    free(value);
   }
-
-  for (int i = 0; i < x; i++)
-    for (int j = 0; j < y; j++)
-      value[i * y + j] = -1;
-
-  int count = 1;
-  value[0] = 0;
-  while (count < x * y) {
-    int i0 = 0;
-    while (i0 < x * y && value[i0] != -1) i0++;
-    value[i0] = i0 + 1;
-    while (i0 < x * y) {
-      int x0 = i0 / y;
-      int y0 = i0 % y;
-      while (true) {
-        int dir = random()&3; // pareil que random()%4
-        switch (dir) {
-        case 0:
-          if (x0 <= 0)
-            continue;
-          x0--;
-          break;
-        case 1:
-          if (y0 <= 0)
-            continue;
-          y0--;
-          break;
-        case 2:
-          if (x0 >= x - 1)
-            continue;
-          x0++;
-          break;
-        case 3:
-          if (y0 >= y - 1)
-            continue;
-          y0++;
-          break;
-        }
-        break;
+  free(S);
+
+  // recollage: labyrinthe des tuiles, puis un passage par frontière
+  int *tvalue = malloc((size_t)TX * TY * sizeof(*tvalue));
+  uint8_t *topen = calloc((size_t)TX * TY, 1);
+  wilson(TX, TY, tvalue, topen, 0, 0, TY, R);
+  for (int a = 0; a < TX; a++)
+    for (int c = 0; c < TY; c++) {
+      const int i0 = a * b, j0 = c * b; // coin de la tuile (a,c)
+      if (topen[a * TY + c] & 1) { // vers la tuile (a+1,c)
+        int j = j0 + rngBelow(R, (y - j0 < b) ? y - j0 : b);
+        open[(size_t)(i0 + b - 1) * y + j] |= 1;
       }
-      if (value[x0 * y + y0] == -1) {
-        value[x0 * y + y0] = i0 + 1;
-        i0 = x0 * y + y0;
-      } else {
-        if (value[x0 * y + y0] > 0) {
-          while (i0 != x0 * y + y0 && i0 > 0) {
-            int i1 = value[i0] - 1;
-            value[i0] = -1;
-            i0 = i1;
-          }
-        } else {
-          int i1 = i0;
-          i0 = x0 * y + y0;
-          do {
-            int x0 = i0 / y;
-            int y0 = i0 % y;
-            int x1 = i1 / y;
-            int y1 = i1 % y;
-            if (x0 < x1)
-              for (int i = 0; i < w; ++i)
-                Gw.value[x1 * (w + 1)][y0 * (w + 1) + i + 1] = V_FREE;
-            if (x0 > x1)
-              for (int i = 0; i < w; ++i)
-                Gw.value[x0 * (w + 1)][y0 * (w + 1) + i + 1] = V_FREE;
-            if (y0 < y1)
-              for (int i = 0; i < w; ++i)
-                Gw.value[x1 * (w + 1) + i + 1][y1 * (w + 1)] = V_FREE;
-            if (y0 > y1)
-              for (int i = 0; i < w; ++i)
-                Gw.value[x1 * (w + 1) + i + 1][y0 * (w + 1)] = V_FREE;
-            i0 = i1;
-            i1 = value[i0] - 1;
-            value[i0] = 0;
-            count++;
-          } while (value[i1] != 0);
-          break;
-        }
+      if (topen[a * TY + c] & 2) { // vers la tuile (a,c+1)
+        int i = i0 + rngBelow(R, (x - i0 < b) ? x - i0 : b);
+        open[(size_t)i * y + j0 + b - 1] |= 2;
       }
     }
-  }
-
-  free(value);
+  free(tvalue);
+  free(topen);
 
+  grid Gw = labyGrid(x, y, w, open);
+  free(open);
   return Gw;
 }
 
+int charValue(char c) {
+  switch (c) {
+  case '#':
+    return V_WALL;
+  case ';':
+    return V_SAND;
+  case '~':
+    return V_WATER;
+  case ',':
+    return V_MUD;
+  case '.':
+    return V_GRASS;
+  case '+':
+    return V_TUNNEL;
+  default: // ' ', 's', 't', ...
+    return V_FREE;
+  }
+}
+
 grid initGridFile(char *file) {
   FILE *f = fopen(file, "r");
   if (f == NULL) {
@@ -768,41 +1245,11 @@ grid initGridFile(char *file) {
     if (L[n - 1] == '\n')
       n--;                        // enlève le '\n' éventuelle
     for (int i = 0; i < n; i++) { // ici n<=x
-      switch (L[i]) {
-      case ' ':
-        v = V_FREE;
-        break;
-      case '#':
-        v = V_WALL;
-        break;
-      case ';':
-        v = V_SAND;
-        break;
-      case '~':
-        v = V_WATER;
-        break;
-      case ',':
-        v = V_MUD;
-        break;
-      case '.':
-        v = V_GRASS;
-        break;
-      case '+':
-        v = V_TUNNEL;
-        break;
-      case 's':
-        v = V_FREE;
-        G.start.x = i;
-        G.start.y = j;
-        break;
-      case 't':
-        v = V_FREE;
-        G.end.x = i;
-        G.end.y = j;
-        break;
-      default:
-        v = V_FREE;
-      }
+      v = charValue(L[i]);
+      if (L[i] == 's')
+        G.start.x = i, G.start.y = j;
+      if (L[i] == 't')
+        G.end.x = i, G.end.y = j;
       G.value[i][j] = v;
     }
   }
@@ -812,361 +1259,266 @@ grid initGridFile(char *file) {
   return G;
 }
 
-void addRandomBlob(grid G, int type, int nb) {
-  // Ne touche pas au bord de la grille.
-  int neighs[8][2] = {{0, -1},  {1, 0},  {0, 1},  {-1, 0},
-                      {-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
-  for (int i = 0; i < nb; i++)
-    G.value[1 + random() % (G.X - 2)][1 + random() % (G.Y - 2)] = type;
-
-  for (int it = 0; it < G.X && it < G.Y; it++)
-    for (int i = 2; i < G.X - 2; i++)
-      for (int j = 2; j < G.Y - 2; j++) {
-        int n = 0;
-        for (int k = 0; k < 4; k++)
-          if (G.value[i + neighs[k][0]][j + neighs[k][1]] == type)
-            n++;
-        if (n && random() % ((4 - n) * 20 + 1) == 0)
-          G.value[i][j] = type;
-      }
-}
+// Croissance des blobs: au lieu de balayer min(X,Y) fois toute la
+// grille, on simule directement ces balayages. Lors d'un balayage, une
+// case (hors du bord) ayant n>0 voisins de type donné prend ce type
+// avec probabilité 1/((4-n)*20+1). Tant que n ne change pas, le numéro
+// du balayage où elle le prend suit donc une loi géométrique, qu'on
+// tire à l'avance. Seules les cases du front (qui ont un voisin du
+// type) sont dans la file, et un événement n'est valide que si la case
+// a toujours le même n (n ne fait qu'augmenter, un nouvel événement a
+// été programmé sinon). Une case colorée à l'instant t modifie ses
+// voisins à partir de t+1.
+//
+// Les colonnes sont découpées en bandes de BLOB_STRIP colonnes, chacune
+// ayant sa file et son générateur aléatoire. À chaque instant t, les
+// bandes sont traitées en parallèle en trois étapes séparées par une
+// barrière: (1) choix des cases à colorer, (2) coloration, (3)
+// reprogrammation des voisins. Les étapes (1) et (3) ne font que lire
+// la grille et l'étape (2) n'écrit que dans sa bande, ce qui rend le
+// résultat indépendant du nombre de threads.
 
-// Initialisation de SDL
-void init_SDL_OpenGL(void) {
+#define BLOB_STRIP 64 // largeur d'une bande
+#define BLOB_RING 256 // nombre de seaux de la file circulaire d'une bande
 
-  SDL_Init(SDL_INIT_VIDEO);
-  window = SDL_CreateWindow(getTitle(), SDL_WINDOWPOS_UNDEFINED,
-      SDL_WINDOWPOS_UNDEFINED, width, height,
-      SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
+typedef struct {
+  int i, j; // case
+  int t;    // instant (numéro de balayage) de la coloration
+  int n;    // nombre de voisins du type lors de la programmation
+} bevent;
 
-  if (window == NULL) { // échec lors de la création de la fenêtre
-    printf("Could not create window: %s\n", SDL_GetError());
-    SDL_Quit();
-    exit(1);
+typedef struct {
+  bevent *e;
+  int n, nmax;
+} bvec;
+
+typedef struct {
+  int i0, i1;            // colonnes [i0,i1[ de la bande
+  rng R;                 // générateur propre à la bande
+  bvec B[BLOB_RING];     // B[t%BLOB_RING] = événements de l'instant t, t+256, ...
+  bvec paint, cand;      // cases colorées à l'instant t, voisins à reprogrammer
+  int pending;           // nombre d'événements dans B[]
+} bstrip;
+
+static void bpush(bvec *V, bevent e) {
+  if (V->n == V->nmax) {
+    V->nmax = V->nmax ? 2 * V->nmax : 16;
+    V->e = realloc(V->e, V->nmax * sizeof(*V->e));
   }
+  V->e[V->n++] = e;
+}
 
-  SDL_GetWindowSize(window, &width, &height);
-  // Contexte OpenGL
-  glcontext = SDL_GL_CreateContext(window);
+static const int blob_dx[4] = {0, 1, 0, -1}, blob_dy[4] = {-1, 0, 1, 0};
 
-  // Projection de base, un point OpenGL == un pixel
-  glMatrixMode(GL_PROJECTION);
-  glLoadIdentity();
-  glOrtho(0.0, width, height, 0.0, 0.0f, 1.0f);
-  glScalef(scale, scale, 1.0);
+// Nombre de voisins de (i,j) de type donné (4-voisinage).
+static inline int blobCount(grid *G, int i, int j, int type) {
+  int n = 0;
+  for (int k = 0; k < 4; k++)
+    n += (G->value[i + blob_dx[k]][j + blob_dy[k]] == type);
+  return n;
+}
 
-  // Some GL options
-  glEnable(GL_LINE_SMOOTH);
-  glEnable(GL_BLEND);
-  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-  glGenTextures(1, &texName);
-  glBindTexture(GL_TEXTURE_2D, texName);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-}
-
-// Fermeture de SDL
-void cleaning_SDL_OpenGL() {
-  SDL_GL_DeleteContext(glcontext);
-  SDL_DestroyWindow(window);
-  SDL_Quit();
-}
-
-// Génère n points aléatoires du rectangle [0,width] × [0,height] et
-// renvoie le tableau des n points (type double) ainsi générés. Met à
-// jour les variables globales vertices[] et num_vertices.
-point *generatePoints(int n) {
-
-  vertices = malloc(n * sizeof(point));
-  const double rx = (double)width / RAND_MAX;
-  const double ry = (double)height / RAND_MAX;
-  for (int i = 0; i < n; i++) {
-    vertices[i].x = random() * rx;
-    vertices[i].y = random() * ry;
-  }
-  num_vertices = n;
-  return vertices;
+// Programme après l'instant t la coloration de la case (i,j) qui a n>0
+// voisins du type. lq[n] = log(1-p) avec p = 1/((4-n)*20+1). Les
+// événements au delà de l'horizon H sont ignorés.
+static void blobSchedule(bstrip *S, int i, int j, int n, int t, int H,
+                         const double *lq) {
+  double d = 1; // nombre de balayages avant coloration, >=1
+  if (n < 4)
+    d += floor(log(1 - rngDouble(&S->R)) / lq[n]);
+  if (t + d >= H)
+    return;
+  t += d;
+  bpush(&S->B[t % BLOB_RING], (bevent){i, j, t, n});
+  S->pending++;
 }
 
-// Génère n points du rectangle [0,width] × [0,height] répartis
-// aléatoirement sur k cercles concentriques.
-point *generateCircles(int n, int k) {
-
-  point c = { width / 2.0, height / 2.0 }; // centre
-  vertices = malloc(n * sizeof(point));
-  const double r0 = ((width<height)? width:height)/(2.2*k);
-
-  for (int i = 0; i < n; i++) { // on place les n points
-    int j = random()%k; // j=numéro du cercle
-    double r = (j+1)*r0;
-    const double K = 2.0 * M_PI / RAND_MAX;
-    double a = K * random();
-    vertices[i].x = c.x + r * cos(a);
-    vertices[i].y = c.y + r * sin(a);
-  }
-
-  num_vertices = n;
-  return vertices;
+static int compareBevent(const void *x, const void *y) {
+  const bevent *a = x, *b = y;
+  return (a->i != b->i) ? a->i - b->i : a->j - b->j;
 }
 
-#define ORANGE .99,.8,.3
-
-void drawTour(point *V, int n, int *P) {
-  static unsigned int last_tick = 0;
-
-  // saute le dessin si le précédent a été fait il y a moins de 20ms
-  // ou si update est faux
-  if ((!update) && (last_tick + 20 > SDL_GetTicks()))
+void addRandomBlob(grid G, int type, int nb, rng *R) {
+  // Ne touche pas au bord de la grille.
+  for (int i = 0; i < nb; i++)
+    G.value[1 + rngBelow(R, G.X - 2)][1 + rngBelow(R, G.Y - 2)] = type;
+  if (G.X < 5 || G.Y < 5)
     return;
-  last_tick = SDL_GetTicks();
 
-  // gestion de la file d'event
-  handleEvent(false);
-
-  // efface la fenêtre
-  glClearColor(0, 0, 0, 1);
-  glClear(GL_COLOR_BUFFER_BIT);
-
-  // dessine le cycle
-  if (V && P && (P[0]>=0)) {
-    glColor3f(1, 1, 1); // Blanc
-    for (int i = 0; i < n; i++){
-      if(oriented)
-        drawEdge(V[P[i]], V[P[(i + 1) % n]]);
-      else
-        drawLine(V[P[i]], V[P[(i + 1) % n]]);
-    }
-    if (root) {
-      glColor3f(ORANGE); // Orange
-      if(oriented && (n>0))
-        drawEdge(V[P[0]], V[P[1]]);
-      else
-        drawLine(V[P[0]], V[P[1]]);
-    }
+  const int H = (G.X < G.Y) ? G.X : G.Y; // nombre de balayages
+  double lq[4];
+  for (int n = 1; n < 4; n++)
+    lq[n] = log(1 - 1.0 / ((4 - n) * 20 + 1));
+
+  // cases [2,G.X-2[ x [2,G.Y-2[, les bandes découpent les colonnes
+  const int ns = (G.X - 4 + BLOB_STRIP - 1) / BLOB_STRIP;
+  bstrip *S = calloc(ns, sizeof(*S));
+  for (int s = 0; s < ns; s++) {
+    S[s].i0 = 2 + s * BLOB_STRIP;
+    S[s].i1 = (S[s].i0 + BLOB_STRIP < G.X - 2) ? S[s].i0 + BLOB_STRIP : G.X - 2;
+    S[s].R = *R;
+    rngJump(R);
   }
 
-  // dessine les points
-  if (V) {
-    glColor3f(1, 0, 0); // Rouge
-    for (int i = 0; i < n; i++)
-      drawPoint(V[i]);
-    if (root && P && (P[0]>=0) ){
-      glColor3f(ORANGE); // Orange
-      drawPoint(V[P[0]]);
+  int pending = 0;
+  #pragma omp parallel
+  {
+    // front initial: les cases ayant déjà un voisin du type
+    #pragma omp for schedule(dynamic) reduction(+:pending)
+    for (int s = 0; s < ns; s++) {
+      for (int i = S[s].i0; i < S[s].i1; i++)
+        for (int j = 2; j < G.Y - 2; j++) {
+          if (G.value[i][j] == type)
+            continue;
+          const int n = blobCount(&G, i, j, type);
+          if (n)
+            blobSchedule(S + s, i, j, n, -1, H, lq);
+        }
+      pending += S[s].pending;
     }
-  }
-
-  // affiche le dessin
-  SDL_GL_SwapWindow(window);
-}
 
-void drawPath(point *V, int n, int *P, int k) {
-  static unsigned int last_tick = 0;
-
-  // saute le dessin si le précédent a été fait il y a moins de 20ms
-  // ou si update est faux
-  if ((!update) && (last_tick + 20 > SDL_GetTicks()))
-    return;
-  last_tick = SDL_GetTicks();
-
-  // gestion de la file d'event
-  handleEvent(false);
+    for (int t = 0; t < H && pending; t++) {
+
+      // (1) événements valides de l'instant t
+      #pragma omp for schedule(dynamic)
+      for (int s = 0; s < ns; s++) {
+        bvec *B = &S[s].B[t % BLOB_RING];
+        int m = 0;
+        S[s].paint.n = 0;
+        for (int k = 0; k < B->n; k++) {
+          const bevent e = B->e[k];
+          if (e.t != t) { // pour un tour suivant de la file
+            B->e[m++] = e;
+            continue;
+          }
+          S[s].pending--;
+          if (G.value[e.i][e.j] != type && blobCount(&G, e.i, e.j, type) == e.n)
+            bpush(&S[s].paint, e);
+        }
+        B->n = m;
+      }
 
-  // efface la fenêtre
-  glClearColor(0, 0, 0, 1);
-  glClear(GL_COLOR_BUFFER_BIT);
+      // (2) coloration
+      #pragma omp for schedule(dynamic)
+      for (int s = 0; s < ns; s++)
+        for (int k = 0; k < S[s].paint.n; k++)
+          G.value[S[s].paint.e[k].i][S[s].paint.e[k].j] = type;
+
+      // (3) reprogrammation des voisins de la bande, sans doublons
+      #pragma omp for schedule(dynamic)
+      for (int s = 0; s < ns; s++) {
+        bvec *C = &S[s].cand;
+        C->n = 0;
+        for (int r = s - 1; r <= s + 1; r++) {
+          if (r < 0 || r >= ns)
+            continue;
+          for (int k = 0; k < S[r].paint.n; k++)
+            for (int d = 0; d < 4; d++) {
+              const int i = S[r].paint.e[k].i + blob_dx[d];
+              const int j = S[r].paint.e[k].j + blob_dy[d];
+              if (i >= S[s].i0 && i < S[s].i1 && j >= 2 && j < G.Y - 2 &&
+                  G.value[i][j] != type)
+                bpush(C, (bevent){i, j, 0, 0});
+            }
+        }
+        qsort(C->e, C->n, sizeof(*C->e), compareBevent);
+        for (int k = 0; k < C->n; k++)
+          if (k == 0 || compareBevent(C->e + k, C->e + k - 1)) {
+            const int i = C->e[k].i, j = C->e[k].j;
+            blobSchedule(S + s, i, j, blobCount(&G, i, j, type), t, H, lq);
+          }
+      }
 
-  // dessine le chemin
-  if (V && P && (P[0]>=0)) {
-    glColor3f(0, 1, 0); // Vert
-    for (int i = 0; i < k - 1; i++){
-      if(oriented)
-        drawEdge(V[P[i]], V[P[(i + 1) % n]]);
-      else
-        drawLine(V[P[i]], V[P[(i + 1) % n]]);
-    }
-    if (root) {
-      glColor3f(ORANGE); // Orange
-      if(oriented && (n>0))
-        drawEdge(V[P[0]], V[P[1]]);
-      else
-        drawLine(V[P[0]], V[P[1]]);
+      #pragma omp single
+      {
+        pending = 0;
+        for (int s = 0; s < ns; s++)
+          pending += S[s].pending;
+      }
     }
   }
 
-  // dessine les points
-  if (V) {
-    glColor3f(1, 0, 0); // Rouge
-    for (int i = 0; i < n; i++)
-      drawPoint(V[i]);
-    if (root && P && (P[0]>=0) ){
-      glColor3f(ORANGE); // Orange
-      drawPoint(V[P[0]]);
-    }
+  for (int s = 0; s < ns; s++) {
+    for (int k = 0; k < BLOB_RING; k++)
+      free(S[s].B[k].e);
+    free(S[s].paint.e);
+    free(S[s].cand.e);
   }
-
-  // affiche le dessin
-  SDL_GL_SwapWindow(window);
+  free(S);
 }
 
-// Dessine le graphe G, les points V et la tournée définie par P
-void drawGraph(point *V, int n, int *P, graph G) {
-  static unsigned int last_tick = 0;
-
-  // saute le dessin si le précédent a été fait il y a moins de 20ms
-  // ou si update est faux
-  if ((!update) && (last_tick + 20 > SDL_GetTicks()))
-    return;
-  last_tick = SDL_GetTicks();
-
-  // gestion de la file d'event
-  handleEvent(false);
-
-  // efface la fenêtre
-  glClearColor(0, 0, 0, 1);
-  glClear(GL_COLOR_BUFFER_BIT);
-
-  // dessine G
-  if (V && G.list && (G.deg[0]>=0) && (mst&1)) {
-    glLineWidth(5.0);
-    glColor3f(0, 0.4, 0); // Vert foncé
-    for (int i = 0; i < n; i++)
-      for (int j = 0; j < G.deg[i]; j++)
-        if (i < G.list[i][j])
-          drawLine(V[i], V[G.list[i][j]]);
-    glLineWidth(1.0);
-  }
-
-  // dessine la tournée
-  if (V && P && (P[0]>=0) && (mst&2)) {
-    glColor3f(1, 1, 1); // Blanc
-    for (int i = 0; i < n; i++){
-      if(oriented)
-        drawEdge(V[P[i]], V[P[(i + 1) % n]]);
-      else
-        drawLine(V[P[i]], V[P[(i + 1) % n]]);
-    }
-    if (root) {
-      glColor3f(ORANGE); // Orange
-      if(oriented && (n>0))
-        drawEdge(V[P[0]], V[P[1]]);
-      else
-        drawLine(V[P[0]], V[P[1]]);
-    }
+// Affichage. Les fonctions drawXXX() ne dessinent pas elles-mêmes:
+// elles publient une copie de ce qu'il faut dessiner, et un thread
+// d'affichage dessine la dernière copie publiée, à frame_rate images
+// par seconde, tout en gérant les évènements. Les deux threads ne
+// s'attendent jamais (triple tampon): l'algorithme remplit sa copie
+// slot[back] puis l'échange atomiquement avec la copie partagée; le
+// thread d'affichage échange sa copie slot[front] avec la copie
+// partagée seulement si elle est nouvelle (bit SNAP_FRESH). Une copie
+// qui n'a pas été dessinée à temps est simplement remplacée.
+//
+// Sous macOS, la fenêtre et ses évènements doivent être gérés par le
+// thread principal: RENDER_THREAD vaut alors 0 et drawXXX() dessine
+// lui-même chaque copie qu'il publie.
+#ifndef RENDER_THREAD
+#ifdef __APPLE__
+#define RENDER_THREAD 0
+#else
+#define RENDER_THREAD 1
+#endif
+#endif
+
+#define SNAP_FRESH 4 // la copie partagée n'a pas encore été dessinée
+
+static snapshot slot[3];
+static int back = 0;               // copie remplie par l'algorithme
+static int front = 1;              // copie dessinée par l'affichage
+static atomic_int shared = 2;      // copie partagée (| SNAP_FRESH)
+static atomic_uint frames;         // nombre d'images dessinées
+#if RENDER_THREAD
+static atomic_bool closing;        // demande l'arrêt du thread d'affichage
+static SDL_Thread *renderThread;
+static SDL_sem *eventSem;          // signalé après chaque lot d'évènements
+#endif
+static SDL_SpinLock dragLock;      // protège dragVertex, dragPos et vx
+static int dragVertex = -1;        // point déplacé à la souris, ou -1
+static point dragPos;              // nouvelle position de ce point
+
+// Agrandit si besoin le tableau T, de *n éléments de taille size, pour
+// qu'il en contienne au moins k.
+static void *grow(void *T, size_t *n, size_t k, size_t size) {
+  if (k > *n) {
+    T = realloc(T, k * size);
+    *n = k;
   }
+  return T;
+}
 
-  // dessine les points
-  if (V) {
-    glColor3f(1, 0, 0); // Rouge
-    for (int i = 0; i < n; i++)
-      drawPoint(V[i]);
-    if (root && P && (P[0]>=0) ){
-      glColor3f(ORANGE); // Orange
-      drawPoint(V[P[0]]);
-    }
-  }
+// Dessine la dernière copie publiée.
+static void renderFrame(void) {
+  static scene S;
 
-  // affiche le dessin
-  SDL_GL_SwapWindow(window);
-}
-#undef ORANGE
+  // prend la copie partagée si elle est nouvelle
+  if (atomic_load(&shared) & SNAP_FRESH)
+    front = atomic_exchange(&shared, front) & 3;
+  snapshot *C = slot + front;
 
-static void drawGridImage(grid G){
-  // Efface la fenêtre
+  // pas de zone PROF_BEGIN() ici: une par image ferait grossir sans fin
+  // les tampons du profileur pendant une session interactive
   glClearColor(0, 0, 0, 1);
   glClear(GL_COLOR_BUFFER_BIT);
-
-  // Dessin
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, G.X, G.Y, 0, GL_RGB, GL_UNSIGNED_BYTE, gridImage);
-  glEnable(GL_TEXTURE_2D);
-  glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_DECAL);
-  glBindTexture(GL_TEXTURE_2D, texName);
-  glBegin(GL_QUADS);
-  glTexCoord2f(0.0, 0.0);
-  glVertex3f(0, 0, 0);
-  glTexCoord2f(0.0, 1.0);
-  glVertex3f(0, G.Y, 0);
-  glTexCoord2f(1.0, 1.0);
-  glVertex3f(G.X, G.Y, 0);
-  glTexCoord2f(1.0, 0.0);
-  glVertex3f(G.X, 0, 0);
-  glEnd();
-  glFlush();
-  glDisable(GL_TEXTURE_2D);
-}
-
-void waitGridDelay(grid G, unsigned int delay, unsigned int frame_delay) {
-  const unsigned int last_tick = SDL_GetTicks();
-  unsigned int current_tick = SDL_GetTicks();
-
-  while(running && current_tick - last_tick < delay) {
-    handleEvent(false);
-    drawGridImage(G);
-    SDL_GL_SwapWindow(window);
-
-    if (delay - (current_tick - last_tick) > frame_delay)
-      SDL_Delay(frame_delay);
-    else
-      SDL_Delay(delay - (current_tick - last_tick));
-    current_tick = SDL_GetTicks();
-  }
-}
-
-void drawGrid(grid G) {
-  static unsigned int last_tick = 0;
-
-  static unsigned int last_drawn_call = 0;
-  static unsigned int call_count = 0;
-
-  const unsigned int frame_rate = 50;
-  const unsigned int frame_delay = 1000 / frame_rate;
-
-  call_count++;
-
-  const unsigned int current_tick = SDL_GetTicks();
-
-  unsigned int next_drawn_call = call_count;
-
-  if(!update)
-    next_drawn_call = last_drawn_call + call_speed / frame_rate;
-
-  if (next_drawn_call > call_count)
-    return;
-
-  unsigned int delay = 0;
-  unsigned int elasped_tick = current_tick - last_tick;
-  unsigned int elasped_call = call_count - last_drawn_call;
-
-  if (elasped_call*1000 > elasped_tick * call_speed)
-    delay = elasped_call*1000 / call_speed - elasped_tick;
-
-  // ceci intervient quand call_speed diminue
-  // le choix suivant est raisonnable au vu de la vitesse des entrées
-  // utilisateur: on dessine la grille sans attendre
-  if (elasped_call > call_speed)
-    delay = 0;
-
-
-  if (!update)
-    waitGridDelay(G, delay, frame_delay);
-
-  makeImage(&G);
-  handleEvent(false);
-
-  drawGridImage(G);
-
-  // Affiche le résultat puis attend un certain délais
+  if (C->kind == SNAP_GRID)
+    drawGridTiles(C);
+  if (C->kind == SNAP_SCENE)
+    drawScene(&S, C);
   SDL_GL_SwapWindow(window);
-  last_tick = current_tick;
-  last_drawn_call = call_count;
+  atomic_fetch_add(&frames, 1);
 }
 
-bool handleEvent(bool wait_event) {
-  bool vertices_have_changed = false;
+// Gère les évènements (cf. handleEvent()) et renvoie vrai s'il y en a
+// eu. Les déplacements de points à la souris sont seulement notés (cf.
+// applyDrag()), car le tableau de points appartient à l'algorithme.
+static bool pumpEvents(bool wait_event) {
   SDL_Event e;
 
   if (wait_event)
@@ -1179,15 +1531,11 @@ bool handleEvent(bool wait_event) {
 
     case SDL_QUIT:
       running = false;
-      update = false;
-      speedSet(speedMax());
       break;
 
     case SDL_KEYDOWN:
       if (e.key.keysym.sym == SDLK_q) {
         running = false;
-        update = false;
-        speedSet(speedMax());
         break;
       }
       if (e.key.keysym.sym == SDLK_p) {
@@ -1212,11 +1560,11 @@ bool handleEvent(bool wait_event) {
         break;
       }
       if (e.key.keysym.sym == SDLK_z || e.key.keysym.sym == SDLK_KP_MINUS) {
-        speedDown();
+        frame_rate = (frame_rate > 1) ? frame_rate / 2 : 1;
         break;
       }
       if (e.key.keysym.sym == SDLK_a || e.key.keysym.sym == SDLK_KP_PLUS) {
-        speedUp();
+        frame_rate = (frame_rate < 200) ? 2 * frame_rate : 200;
         break;
       }
       break;
@@ -1247,11 +1595,13 @@ bool handleEvent(bool wait_event) {
         double x, y;
         pixelToCoord(e.motion.x, e.motion.y, &x, &y);
         if (hover) {
+          SDL_AtomicLock(&dragLock); // vertices[] et son index
           int v = getClosestVertex(x, y);
-          if ((x - vertices[v].x) * (x - vertices[v].x) +
+          if (v >= 0 && (x - vertices[v].x) * (x - vertices[v].x) +
                   (y - vertices[v].y) * (y - vertices[v].y) <
               30.0f)
             selectedVertex = v;
+          SDL_AtomicUnlock(&dragLock);
         }
         mouse_ldown = true;
       }
@@ -1271,9 +1621,12 @@ bool handleEvent(bool wait_event) {
     case SDL_MOUSEMOTION:
       if (hover && !mouse_rdown && mouse_ldown &&
           selectedVertex >= 0) {
-        pixelToCoord(e.motion.x, e.motion.y, &(vertices[selectedVertex].x),
-                     &(vertices[selectedVertex].y));
-        vertices_have_changed = true;
+        double x, y;
+        pixelToCoord(e.motion.x, e.motion.y, &x, &y);
+        SDL_AtomicLock(&dragLock);
+        dragVertex = selectedVertex;
+        dragPos.x = x, dragPos.y = y;
+        SDL_AtomicUnlock(&dragLock);
       }
       if (mouse_rdown) {
         glTranslatef(e.motion.xrel / scale, e.motion.yrel / scale, 0);
@@ -1283,6 +1636,297 @@ bool handleEvent(bool wait_event) {
     }
   } while (SDL_PollEvent(&e));
 
-  return vertices_have_changed;
+  return true;
+}
+
+// Reporte dans le tableau de points le dernier déplacement noté par
+// pumpEvents(). Renvoie vrai si un point a bougé.
+static bool applyDrag(void) {
+  bool moved = false;
+  SDL_AtomicLock(&dragLock);
+  if (dragVertex >= 0 && dragVertex < num_vertices) {
+    vertices[dragVertex] = dragPos;
+    vxMove(dragVertex);
+    moved = true;
+  }
+  dragVertex = -1;
+  SDL_AtomicUnlock(&dragLock);
+  return moved;
+}
+
+// Vrai si drawXXX() doit publier une copie: toujours si update, sinon
+// au plus une fois par image affichée. Avec le thread d'affichage, le
+// test ne coûte qu'une lecture atomique, ce qui permet d'appeler
+// drawGrid() à chaque étape d'un algorithme.
+static bool snapDue(void) {
+  static unsigned last = UINT_MAX;
+#if RENDER_THREAD
+  const unsigned f = atomic_load_explicit(&frames, memory_order_relaxed);
+#else
+  const unsigned f = SDL_GetTicks() / (1000 / frame_rate);
+#endif
+  if (!update && f == last)
+    return false;
+  last = f;
+  return true;
+}
+
+// Publie la grille G dans slot[back]: seule sa description est copiée.
+static void snapGrid(grid G) {
+  snapshot *C = slot + back;
+  C->kind = SNAP_GRID;
+  C->G = G;
+  C->tracked = tracked && stampGrid == G.value;
+  C->gridId = gridCount;
+  atomic_store(&liveGrid, G.value);
+}
+
+// Copie dans slot[back] les points V, les e arêtes P[i]->P[(i+1)%n] (si
+// P est défini) de couleur (r,g,b), et le graphe G (si G!=NULL).
+static void snapScene(point *V, int n, int *P, int e, graph *G,
+                      GLfloat r, GLfloat g, GLfloat b) {
+  snapshot *C = slot + back;
+  if (V == NULL)
+    n = 0;
+  const bool tour = P && P[0] >= 0 && n > 0;
+  C->kind = SNAP_SCENE;
+  C->n = n;
+  C->e = tour ? e : 0;
+  C->m = tour ? ((e + 1 < n) ? e + 1 : n) : 0; // cases utilisées de P
+  C->V = grow(C->V, &C->nV, n, sizeof(*C->V));
+  C->P = grow(C->P, &C->nP, C->m, sizeof(*C->P));
+  if (n)
+    memcpy(C->V, V, n * sizeof(*V));
+  if (C->m)
+    memcpy(C->P, P, C->m * sizeof(*P));
+
+  C->ne = 0;
+  if (G && G->list && G->deg[0] >= 0 && n) { // arêtes i<j du graphe
+    size_t k = 0;
+    for (int i = 0; i < n; i++)
+      k += 2 * G->deg[i];
+    C->E = grow(C->E, &C->nE, k, sizeof(*C->E));
+    for (int i = 0; i < n; i++)
+      for (int j = 0; j < G->deg[i]; j++)
+        if (i < G->list[i][j])
+          C->E[C->ne++] = i, C->E[C->ne++] = G->list[i][j];
+  }
+  C->rgb[0] = r, C->rgb[1] = g, C->rgb[2] = b;
+}
+
+// Publie slot[back] et récupère l'ancienne copie partagée pour la
+// prochaine publication. Sans thread d'affichage, la dessine aussitôt.
+static void snapPublish(void) {
+  slot[back].seq = snapSeq++;
+  back = atomic_exchange(&shared, back | SNAP_FRESH) & 3;
+#if !RENDER_THREAD
+  pumpEvents(false);
+  renderFrame();
+#endif
+}
+
+// Création de la fenêtre et du contexte OpenGL, par le thread qui
+// dessine et gère les évènements.
+static void openWindow(void) {
+  SDL_Init(SDL_INIT_VIDEO);
+  window = SDL_CreateWindow(getTitle(), SDL_WINDOWPOS_UNDEFINED,
+      SDL_WINDOWPOS_UNDEFINED, width, height,
+      SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
+
+  if (window == NULL) { // échec lors de la création de la fenêtre
+    printf("Could not create window: %s\n", SDL_GetError());
+    SDL_Quit();
+    exit(1);
+  }
+
+  SDL_GetWindowSize(window, &width, &height);
+  // Contexte OpenGL
+  glcontext = SDL_GL_CreateContext(window);
+
+  // Projection de base, un point OpenGL == un pixel
+  glMatrixMode(GL_PROJECTION);
+  glLoadIdentity();
+  glOrtho(0.0, width, height, 0.0, 0.0f, 1.0f);
+  glScalef(scale, scale, 1.0);
+
+  // Some GL options
+  glEnable(GL_LINE_SMOOTH);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  // tuiles de la grille (cf. drawGridTiles()) pas plus grandes que permis
+  GLint maxtex = 0;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxtex);
+  while (maxtex > 0 && texBits > 4 && (1 << texBits) > maxtex)
+    texBits--;
+
+  // Tampons de sommets pour drawTour(), drawPath() et drawGraph()
+  pglGenBuffers = (PFNGLGENBUFFERSPROC)SDL_GL_GetProcAddress("glGenBuffers");
+  pglBindBuffer = (PFNGLBINDBUFFERPROC)SDL_GL_GetProcAddress("glBindBuffer");
+  pglBufferData = (PFNGLBUFFERDATAPROC)SDL_GL_GetProcAddress("glBufferData");
+  if (!pglGenBuffers || !pglBindBuffer || !pglBufferData)
+    pglBindBuffer = NULL; // tableaux de sommets en mémoire centrale
 }
 
+#if RENDER_THREAD
+// Boucle du thread d'affichage.
+static int renderLoop(void *data) {
+  (void)data;
+  openWindow();
+  SDL_SemPost(eventSem); // la fenêtre est prête
+
+  while (!atomic_load(&closing)) {
+    const Uint32 t = SDL_GetTicks();
+    if (pumpEvents(false))
+      SDL_SemPost(eventSem);
+    renderFrame();
+    const Uint32 d = SDL_GetTicks() - t, f = 1000 / frame_rate;
+    if (d < f)
+      SDL_Delay(f - d);
+  }
+
+  SDL_GL_DeleteContext(glcontext);
+  SDL_DestroyWindow(window);
+  return 0;
+}
+#endif
+
+// Initialisation de SDL
+void init_SDL_OpenGL(void) {
+#if RENDER_THREAD
+  eventSem = SDL_CreateSemaphore(0);
+  renderThread = SDL_CreateThread(renderLoop, "render", NULL);
+  SDL_SemWait(eventSem); // attend que la fenêtre soit créée
+#else
+  openWindow();
+#endif
+}
+
+// Fermeture de SDL
+void cleaning_SDL_OpenGL() {
+#if RENDER_THREAD
+  atomic_store(&closing, true);
+  SDL_WaitThread(renderThread, NULL);
+  SDL_DestroySemaphore(eventSem);
+#else
+  SDL_GL_DeleteContext(glcontext);
+  SDL_DestroyWindow(window);
+#endif
+  SDL_Quit();
+}
+
+// Nombre de points générés avec un même flot aléatoire (cf. rng.h).
+#define POINT_BLOCK 4096
+
+// Génère n points aléatoires du rectangle [0,width] × [0,height] et
+// renvoie le tableau des n points (type double) ainsi générés. Met à
+// jour les variables globales vertices[] et num_vertices. Le résultat
+// ne dépend que de l'état de R, pas du nombre de threads.
+point *generatePoints(int n, rng *R) {
+
+  point *V = malloc(n * sizeof(point));
+  const int nc = (n + POINT_BLOCK - 1) / POINT_BLOCK;
+  rng *S = malloc(nc * sizeof(*S));
+  rngStreams(R, S, nc);
+  #pragma omp parallel for schedule(dynamic)
+  for (int c = 0; c < nc; c++) {
+    const int i0 = c * POINT_BLOCK;
+    const int m = (n - i0 < POINT_BLOCK) ? n - i0 : POINT_BLOCK;
+    rngFill(S + c, &V[i0].x, 2 * m); // point = deux double
+    for (int i = i0; i < i0 + m; i++) {
+      V[i].x *= width;
+      V[i].y *= height;
+    }
+  }
+  free(S);
+  SDL_AtomicLock(&dragLock); // cf. getClosestVertex()
+  vertices = V;
+  num_vertices = n;
+  vx.valid = false; // index à reconstruire
+  SDL_AtomicUnlock(&dragLock);
+  return V;
+}
+
+// Génère n points du rectangle [0,width] × [0,height] répartis
+// aléatoirement sur k cercles concentriques.
+point *generateCircles(int n, int k, rng *R) {
+
+  point c = { width / 2.0, height / 2.0 }; // centre
+  point *V = malloc(n * sizeof(point));
+  const double r0 = ((width<height)? width:height)/(2.2*k);
+  const int nc = (n + POINT_BLOCK - 1) / POINT_BLOCK;
+  rng *S = malloc(nc * sizeof(*S));
+  rngStreams(R, S, nc);
+
+  #pragma omp parallel for schedule(dynamic)
+  for (int b = 0; b < nc; b++)
+    for (int i = b * POINT_BLOCK; i < n && i < (b + 1) * POINT_BLOCK; i++) {
+      int j = rngBelow(S + b, k); // j=numéro du cercle
+      double r = (j+1)*r0;
+      double a = 2.0 * M_PI * rngDouble(S + b);
+      V[i].x = c.x + r * cos(a);
+      V[i].y = c.y + r * sin(a);
+    }
+
+  free(S);
+  SDL_AtomicLock(&dragLock); // cf. getClosestVertex()
+  vertices = V;
+  num_vertices = n;
+  vx.valid = false; // index à reconstruire
+  SDL_AtomicUnlock(&dragLock);
+  return V;
+}
+
+void drawTour(point *V, int n, int *P) {
+  // saute le dessin si le précédent a été publié pendant la même image
+  // ou si update est faux
+  if (!snapDue())
+    return;
+
+  // publie le cycle (en blanc) et les points
+  snapScene(V, n, P, n, NULL, 1, 1, 1);
+  snapPublish();
+}
+
+void drawPath(point *V, int n, int *P, int k) {
+  if (!snapDue())
+    return;
+
+  // publie le chemin (en vert) et les points
+  snapScene(V, n, P, (k > 1) ? k - 1 : 0, NULL, 0, 1, 0);
+  snapPublish();
+}
+
+// Dessine le graphe G, les points V et la tournée définie par P
+void drawGraph(point *V, int n, int *P, graph G) {
+  if (!snapDue())
+    return;
+
+  // publie G, la tournée (en blanc) et les points, selon mst
+  snapScene(V, n, P, (mst & 2) ? n : 0, (mst & 1) ? &G : NULL, 1, 1, 1);
+  snapPublish();
+}
+
+// Publie une copie de la grille G au plus une fois par image affichée
+// (à chaque appel si update). L'algorithme n'attend jamais l'affichage.
+void drawGrid(grid G) {
+  if (!snapDue())
+    return;
+  snapGrid(G);
+  snapPublish();
+}
+
+bool handleEvent(bool wait_event) {
+#if RENDER_THREAD
+  // les évènements sont gérés par le thread d'affichage
+  if (wait_event)
+    SDL_SemWait(eventSem);
+  while (SDL_SemTryWait(eventSem) == 0)
+    ; // signaux déjà reçus
+#else
+  pumpEvents(wait_event);
+#endif
+  return applyDrag();
+}
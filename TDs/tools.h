@@ -11,6 +11,10 @@
 #include <time.h>
 #include <sys/time.h>
 #include <limits.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "rng.h"
+#include "prof.h"
 
 #ifdef __APPLE__
 #include <OpenGL/glu.h>
@@ -43,9 +47,19 @@ typedef struct {
 // cas "false" est renvoyée.
 bool NextPermutation(int *P, const int n);
 
+// Comme NextPermutation(), mais on ne permute entre elles que les
+// positions d'un même bloc [C[j-1],C[j][ (avec C[-1]=0), le dernier
+// élément de C valant n. Le premier bloc varie le plus vite. Quand un
+// bloc a épuisé ses permutations, il est remis à P[i]=i: chaque bloc
+// doit donc contenir les valeurs de ses positions (partir de P[i]=i),
+// P servant d'indices dans le tableau des éléments à permuter. Avec k
+// blocs de même taille, il y a (n/k)!^k permutations au lieu de n!.
+// Ex: C={1,n-1,n} fixe P[0] et P[n-1] et permute le reste.
+bool NextConstrainedPermutation(int *P, const int n, const int *C);
+
 // Primitives de dessin.
-point *generatePoints(int n); // n points au hasard
-point *generateCircles(int n, int k); // n points au hasard sur n cercles
+point *generatePoints(int n, rng *R); // n points au hasard
+point *generateCircles(int n, int k, rng *R); // n points au hasard sur k cercles
 void drawTour(point *V, int n, int *P); // affichage de la tournée P
 void drawPath(point *V, int n, int *P, int k); // affiche les k premier points
 
@@ -71,15 +85,27 @@ typedef struct {
   int x, y;
 } position;
 
-// Une grille.
+// Une grille. Les cases (un octet chacune) sont stockées dans un seul
+// bloc contigu, colonne par colonne, entouré d'un bord sentinelle
+// d'une case qui vaut V_WALL pour .value et M_NULL pour .mark. Ainsi
+// value[i][j] reste valide pour -1<=i<=X et -1<=j<=Y, et les parcours
+// de voisins n'ont pas besoin de tester les bornes. Si p=&value[i][j]
+// alors p[nbr[k]] est la valeur du k-ème voisin de (i,j), le voisin
+// étant (i+nbr_dx[k],j+nbr_dy[k]); idem pour .mark.
 typedef struct {
-  int X, Y;       // dimensions: X et Y
-  int **value;    // valuation des cases: value[i][j], 0<=i<X, 0<=j<Y
-  int **mark;     // marquage des cases: mark[i][j], 0<=i<X, 0<=j<Y
-  position start; // position de la source
-  position end;   // position de la destination
+  int X, Y;         // dimensions: X et Y
+  uint8_t **value;  // valuation des cases: value[i][j], 0<=i<X, 0<=j<Y
+  uint8_t **mark;   // marquage des cases: mark[i][j], 0<=i<X, 0<=j<Y
+  position start;   // position de la source
+  position end;     // position de la destination
+  int stride;       // écart entre value[i][j] et value[i+1][j], soit Y+2
+  int nbr[8];       // écarts des 8 voisins dans le bloc
 } grid;
 
+// Déplacements (dx,dy) des 8 voisins, dans l'ordre de grid.nbr[].
+static const int nbr_dx[8] = {-1, -1, -1, 0, 0, 1, 1, 1};
+static const int nbr_dy[8] = {-1, 0, 1, -1, 1, -1, 0, 1};
+
 // Valeurs possibles des cases d'une grille pour les champs .value et
 // .mark. L'ordre est important: il doit être cohérent avec les
 // tableaux color[] (tools.c) et weight[] (a_star.c).
@@ -114,13 +140,40 @@ enum {
 // Routine de dessin et de construction de grilles. Le point (0,0) de
 // la grille est le coin en haut à gauche.
 
+// Les fonctions drawXXX() ne dessinent pas elles-mêmes: elles publient
+// une copie de leurs données, dessinée par un thread d'affichage qui
+// gère aussi les évènements. Elles n'attendent jamais l'affichage et ne
+// copient qu'une fois par image affichée, sauf si update est vrai.
+
 void drawGrid(grid); // affiche une grille
-grid initGridLaby(int,int,int w); // construit un labyrithne x,y,w
-grid initGridPoints(int,int,int t,double p); // point aléatoires d'un type et proba donnés
+
+// Signale que la case (i,j) de la dernière grille allouée a changé:
+// l'affichage ne recolorie et n'envoie à la carte graphique que les
+// tuiles visibles qui contiennent des cases signalées. Tant qu'aucune
+// case n'a été signalée, les tuiles visibles sont recoloriées à chaque
+// image. La grille est dessinée par tuiles de textures, à un niveau de
+// détail qui dépend du zoom, ce qui borne la mémoire utilisée quelle
+// que soit sa taille.
+void gridTouch(int i, int j);
+
+// G.mark[i][j] = m (resp. G.value[i][j] = v) en le signalant à drawGrid()
+static inline void setMark(grid G, int i, int j, int m) {
+  G.mark[i][j] = m;
+  gridTouch(i, j);
+}
+static inline void setValue(grid G, int i, int j, int v) {
+  G.value[i][j] = v;
+  gridTouch(i, j);
+}
+
+grid initGridLaby(int,int,int w,rng *R); // construit un labyrithne x,y,w
+grid initGridLabyTiled(int,int,int w,int b,rng *R); // idem, par tuiles b x b en parallèle
+grid initGridPoints(int,int,int t,double p,rng *R); // point aléatoires d'un type et proba donnés
 grid initGridFile(char*); // construit une grille depuis un fichier
+int charValue(char); // valeur d'un caractère d'un fichier de grille
 
 // ajoute à une grille n "blobs" de type donné t
-void addRandomBlob(grid,int t,int n);
+void addRandomBlob(grid,int t,int n,rng *R);
 
 void freeGrid(grid); // libère la mémoire alouée par une grille
 
@@ -133,9 +186,9 @@ void freeGrid(grid); // libère la mémoire alouée par une grille
 
 
 // Quelques variables globales.
-bool update;        // si vrai, force le dessin dans les fonctions drawXXX()
+bool update;        // si vrai, chaque appel à drawXXX() publie une copie
 int width, height;  // taille de la fenêtre, mise à jour si redimensionnée
-bool running;       // devient faux si 'q' est pressé
+_Atomic bool running; // devient faux si 'q' est pressé
 bool hover;         // si vrai, permet de déplacer un sommet
 bool erase;         // pour A*: efface les couleurs à la fin ou pas
 int delay;          // pour A*: délais d'affichage pour drawGrid(), unité = 0"01
@@ -148,21 +201,17 @@ void init_SDL_OpenGL(void);
 void cleaning_SDL_OpenGL(void);
 
 // Gestion des évènements (souris, redimensionnement de la
-// fenêtre). Renvoie s'il y a eut un évènement. Si wait_event = true,
-// alors on attend qu'un évènement se produise (et on le gère). Sinon,
-// on n'attend pas et on gère l'évènement courant.
+// fenêtre). Les évènements sont gérés par le thread d'affichage; renvoie
+// vrai si un point a été déplacé à la souris depuis le dernier appel (le
+// déplacement est alors reporté dans le tableau de points). Si
+// wait_event = true, alors on attend qu'un évènement se produise.
 //
-//  q -> passe running à false (et aussi update=false et delay=0)
-//  a -> accélère drawGrid() en diminuant delay
-//  z -> ralentis drawGrid() en augmentant delay
-//  p -> pause pendant 0"5 (maintenir pour pose plus longue)
+//  q -> passe running à false
+//  a -> double le nombre d'images affichées par seconde
+//  z -> divise par deux le nombre d'images affichées par seconde
+//  p -> fige l'affichage pendant 0"5 (maintenir pour pose plus longue)
 //  c -> maintient ou supprime les sommets visités à la fin de A*
 //
 bool handleEvent(bool wait_event);
 
-// fonction de chronométrage. Renvoie une durée (écrite sous forme de
-// texte) depuis le dernier apppel à la fonction TopChrono(i) où i est
-// le numéro de chronomètre souhaité.
-char *TopChrono(const int i);
-
 #endif
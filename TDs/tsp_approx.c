@@ -14,41 +14,46 @@ void reverse(int *T, int p, int q) {
   }
 }
 
-double first_flip(point *V, int n, int *P) {
+double first_flip(const distmat *M, int n, int *P) {
   // renvoie le gain>0 du premier flip réalisable, tout en réalisant
   // le flip, et 0 s'il n'y en a pas
+  PROF_BEGIN("first_flip");
   for(int i=0; i < n - 1; i ++){
     for(int j = i + 2; j < n; j ++){
-      double g = (dist(V[P[i]], V[P[i + 1]]) + dist(V[P[j]], V[P[(j + 1)%n]])) // before
-                - (dist(V[P[i]], V[P[j]]) + dist(V[P[i + 1]], V[P[(j + 1)%n]])); // after
+      double g = (distGet(M, P[i], P[i + 1]) + distGet(M, P[j], P[(j + 1)%n])) // before
+                - (distGet(M, P[i], P[j]) + distGet(M, P[i + 1], P[(j + 1)%n])); // after
 
       if(g > 0){
         reverse(P, i+1, j);
+        PROF_END();
         return g;
       }
     }
   }
 
+  PROF_END();
   return 0.0;
 }
 
-double tsp_flip(point *V, int n, int *P) {
+double tsp_flip(point *V, int n, int *P, const distmat *M) {
   // la fonction doit renvoyer la valeur de la tournée obtenue. Pensez
   // à initialiser P, par exemple à P[i]=i. Pensez aussi faire
   // drawTour() pour visualiser chaque flip
-  
+  PROF_BEGIN("tsp_flip");
+
   for(int i=0; i<n; i++){
     P[i] = i;
   }
 
-  while((first_flip(V, n, P)) > 0){
+  while((first_flip(M, n, P)) > 0){
     drawTour(V, n, P);
   }
-  
-  return value(V, n, P);
+
+  PROF_END();
+  return value(M, n, P);
 }
 
-double tsp_greedy(point *V, int n, int *P) {
+double tsp_greedy(point *V, int n, int *P, const distmat *M) {
   ;
   ;
   ;
@@ -0,0 +1,273 @@
+//
+//  TSP - BRANCH-AND-BOUND
+//
+// Solveur exact: on construit la tournée en profondeur à partir de la
+// ville 0 et on coupe toute branche dont la borne inférieure atteint la
+// longueur de la meilleure tournée connue (initialement celle de
+// tsp_mst() améliorée par des flips et des déplacements de segments).
+//
+// Borne: pour des pénalités pi[] quelconques, posons c'(u,v) = d(u,v) +
+// pi[u] + pi[v]. Le reste de la tournée, après le chemin préfixe P[0..k]
+// de longueur L, est un chemin de P[k] à 0 qui passe par toutes les
+// villes R non visitées. Il contient un arbre couvrant R, une arête de
+// P[k] vers R et une arête de 0 vers R, et chaque v de R y est de degré
+// 2. D'où la borne:
+//
+//   L + MST'(R) + min c'(P[k],R) + min c'(0,R) - 2*pi(R) - pi[P[k]] - pi[0]
+//
+// Les pénalités sont calculées une fois à la racine par l'optimisation
+// par sous-gradient de Held et Karp: pi[v] augmente si v est de degré
+// > 2 dans le 1-arbre de poids minimum, et diminue s'il est de degré 1.
+// Les arbres couvrants sont calculés par l'algorithme de Kruskal de
+// tsp_mst.c (arêtes triées par compEdge(), union-find Find()/Union()).
+//
+// Si l'on quitte avec 'q', la meilleure tournée trouvée est renvoyée.
+
+#define BNB_RESTARTS 20 // recherches locales pour la tournée initiale
+
+typedef struct {
+  int n;
+  double *D;            // D[u*n+v] = dist(V[u],V[v])
+  double *pi;           // pénalités de Held-Karp
+  edge *E;              // les m arêtes triées par poids c'
+  int m;
+  int *nbr;             // nbr[u*n+i] = i-ème ville la plus proche de u
+  int *P;               // chemin en construction
+  bool *used;           // used[v] = v est dans P
+  int *parent, *height; // union-find
+  double best;          // longueur de la meilleure tournée
+  int *Q;               // meilleure tournée
+  point *V;             // pour drawTour()
+} bnb;
+
+// Poids c' d'un 1-arbre minimum pour les pénalités B->pi: un arbre
+// couvrant de poids minimum des villes 1..n-1 plus les deux arêtes les
+// plus légères de la ville 0. Écrit les degrés dans deg[].
+static double oneTree(bnb *B, int *deg) {
+  const int n = B->n;
+  edge *E = B->E;
+  for (int k = 0; k < B->m; k++)
+    E[k].weight = B->D[E[k].u * n + E[k].v] + B->pi[E[k].u] + B->pi[E[k].v];
+  qsort(E, B->m, sizeof(edge), compEdge);
+
+  for (int v = 0; v < n; v++) B->parent[v] = v, B->height[v] = 0, deg[v] = 0;
+  double w = 0;
+  int e0 = 0;
+  for (int k = 0, c = 0; k < B->m; k++) {
+    const int u = E[k].u, v = E[k].v;
+    if (u == 0) { // arête de la ville 0
+      if (e0 < 2) e0++, w += E[k].weight, deg[0]++, deg[v]++;
+      continue;
+    }
+    if (c == n - 2) continue;
+    const int x = Find(u, B->parent), y = Find(v, B->parent);
+    if (x == y) continue;
+    Union(x, y, B->parent, B->height);
+    w += E[k].weight, deg[u]++, deg[v]++, c++;
+  }
+  return w;
+}
+
+// Optimisation par sous-gradient des pénalités (Held-Karp). Le pas est
+// proportionnel à l'écart à la meilleure tournée et divisé par deux
+// après n itérations sans progrès. Renvoie la borne inférieure obtenue
+// et laisse dans B->pi les pénalités qui la réalisent.
+static double heldKarp(bnb *B) {
+  const int n = B->n;
+  int deg[n];
+  double pi[n], lb = -DBL_MAX, lambda = 2;
+  for (int v = 0; v < n; v++) B->pi[v] = pi[v] = 0;
+
+  for (int it = 0, stall = 0; it < 50 * n && lambda > 1E-4; it++) {
+    double w = oneTree(B, deg), s = 0;
+    for (int v = 0; v < n; v++) w -= 2 * B->pi[v];
+    if (w > lb + 1E-9) {
+      lb = w, stall = 0;
+      memcpy(pi, B->pi, sizeof(pi));
+    } else if (++stall == n)
+      lambda /= 2, stall = 0;
+    for (int v = 0; v < n; v++) s += (deg[v] - 2) * (deg[v] - 2);
+    if (s == 0) break; // le 1-arbre est une tournée optimale
+    const double t = lambda * (B->best - w) / s;
+    for (int v = 0; v < n; v++) B->pi[v] += t * (deg[v] - 2);
+  }
+
+  memcpy(B->pi, pi, sizeof(pi));
+  oneTree(B, deg); // trie E selon les pénalités retenues
+  return lb;
+}
+
+// Borne inférieure de toute tournée prolongeant P[0..k] (k>0) de
+// longueur L, cf. le début du fichier. Les r>1 villes non visitées sont
+// celles avec used[v] = false.
+static double bound(bnb *B, int k, double L, int r) {
+  const int n = B->n, last = B->P[k];
+  const double *pi = B->pi;
+  double w = L - pi[last] - pi[0], a = DBL_MAX, b = DBL_MAX;
+
+  for (int v = 1; v < n; v++) {
+    if (B->used[v]) continue;
+    B->parent[v] = v, B->height[v] = 0;
+    w -= 2 * pi[v];
+    a = fmin(a, B->D[last * n + v] + pi[last] + pi[v]);
+    b = fmin(b, B->D[v] + pi[0] + pi[v]);
+  }
+  w += a + b;
+
+  // arbre couvrant minimum de R, les arêtes étant déjà triées par c'
+  for (int e = 0, c = 0; c < r - 1; e++) {
+    const int u = B->E[e].u, v = B->E[e].v;
+    if (u == 0 || B->used[u] || B->used[v]) continue;
+    const int x = Find(u, B->parent), y = Find(v, B->parent);
+    if (x == y) continue;
+    Union(x, y, B->parent, B->height);
+    w += B->E[e].weight, c++;
+    if (w >= B->best) break; // inutile d'aller plus loin
+  }
+  return w;
+}
+
+// Prolonge le chemin P[0..k] de longueur L.
+static void bnbExtend(bnb *B, int k, double L) {
+  const int n = B->n, last = B->P[k], r = n - 1 - k;
+
+  if (r == 0) { // tournée complète
+    L += B->D[last * n];
+    if (L < B->best) {
+      B->best = L;
+      memcpy(B->Q, B->P, n * sizeof(int));
+      drawTour(B->V, n, B->Q);
+    }
+    return;
+  }
+  if (r > 1 && bound(B, k, L, r) >= B->best) return;
+
+  // les villes les plus proches d'abord (last elle-même est écartée
+  // par used[], quelle que soit sa place dans nbr s'il y a des doublons)
+  for (int i = 0; i < n && running; i++) {
+    const int v = B->nbr[last * n + i];
+    if (B->used[v]) continue;
+    B->used[v] = true, B->P[k + 1] = v;
+    bnbExtend(B, k + 1, L + B->D[last * n + v]);
+    B->used[v] = false;
+  }
+}
+
+// Déplace, s'il en existe, un segment de 1 à 3 villes consécutives de
+// la tournée Q vers une autre arête de Q, éventuellement retourné, de
+// façon à la raccourcir (Or-opt). Renvoie le gain, 0 si aucun
+// déplacement n'améliore Q.
+static double orMove(bnb *B, int *Q) {
+  const int n = B->n;
+  const double *D = B->D;
+#define d(x, y) D[(x) * n + (y)]
+#define q(o) Q[(i + (o)) % n] // ville à la position i+o
+  for (int s = 1; s <= 3; s++)
+    for (int i = 0; i < n; i++) {
+      // le segment a..b = q(0..s-1) est retiré d'entre p et c
+      const int a = q(0), b = q(s - 1), c = q(s), p = q(n - 1);
+      const double g0 = d(p, a) + d(b, c) - d(p, c);
+      // puis inséré dans une arête x-y = q(o)-q(o+1) du reste
+      for (int o = s; o < n - 1; o++) {
+        const int x = q(o), y = q(o + 1);
+        const double g1 = g0 + d(x, y) - d(x, a) - d(b, y); // x a..b y
+        const double g2 = g0 + d(x, y) - d(x, b) - d(a, y); // x b..a y
+        if (g1 < 1E-9 && g2 < 1E-9) continue;
+        int T[n], k = 0;
+        for (int t = s; t <= o; t++) T[k++] = q(t);
+        for (int t = 0; t < s; t++) T[k++] = q(g1 >= g2 ? t : s - 1 - t);
+        for (int t = o + 1; t < n; t++) T[k++] = q(t);
+        memcpy(Q, T, n * sizeof(int));
+        return fmax(g1, g2);
+      }
+    }
+#undef q
+#undef d
+  return 0;
+}
+
+// Distances de la ville dont on trie les voisins (cf. tsp_bnb()).
+static const double *nbrDist;
+
+static int compNbr(const void *x, const void *y) {
+  const double a = nbrDist[*(int *)x], b = nbrDist[*(int *)y];
+  return (a > b) - (a < b);
+}
+
+double tsp_bnb(point *V, int n, int *Q, const distmat *M) {
+  PROF_BEGIN("tsp_bnb");
+  for (int i = 0; i < n; i++) Q[i] = i;
+  if (n <= 3) {
+    PROF_END();
+    return value(M, n, Q);
+  }
+
+  bnb B = {.n = n, .V = V, .Q = Q};
+  const int m = n * (n - 1) / 2;
+  B.D = malloc(n * n * sizeof(*B.D));
+  B.pi = malloc(n * sizeof(*B.pi));
+  B.E = malloc(m * sizeof(*B.E));
+  B.nbr = malloc(n * n * sizeof(*B.nbr));
+  B.P = malloc(n * sizeof(*B.P));
+  B.used = calloc(n, sizeof(*B.used));
+  B.parent = malloc(n * sizeof(*B.parent));
+  B.height = malloc(n * sizeof(*B.height));
+  for (int u = 0; u < n; u++)
+    for (int v = 0; v < n; v++) B.D[u * n + v] = distGet(M, u, v);
+  for (int u = 0; u < n; u++)
+    for (int v = u + 1; v < n; v++) B.E[B.m++] = (edge){u, v, 0};
+  for (int u = 0; u < n; u++) {
+    for (int v = 0; v < n; v++) B.nbr[u * n + v] = v;
+    nbrDist = B.D + u * n;
+    qsort(B.nbr + u * n, n, sizeof(int), compNbr);
+  }
+
+  // tournée initiale: MST puis flips, commençant par la ville 0
+  PROF_BEGIN("tsp_bnb/initial");
+  graph T = createGraph(n);
+  tsp_mst(V, n, B.P, T, M);
+  freeGraph(T);
+  rng R;
+  rngSeed(&R, n);
+  B.best = DBL_MAX;
+  for (int r = 0; r < BNB_RESTARTS; r++) {
+    if (r) // tournée aléatoire
+      for (int i = n - 1; i > 0; i--) {
+        const int j = rngBelow(&R, i + 1), t = B.P[i];
+        B.P[i] = B.P[j], B.P[j] = t;
+      }
+    while (first_flip(M, n, B.P) > 0 || orMove(&B, B.P) > 0)
+      ;
+    const double w = value(M, n, B.P);
+    if (w >= B.best) continue;
+    B.best = w;
+    int z = 0;
+    while (B.P[z]) z++;
+    for (int i = 0; i < n; i++) Q[i] = B.P[(z + i) % n];
+  }
+  PROF_END();
+
+  PROF_BEGIN("tsp_bnb/heldKarp");
+  const double lb = heldKarp(&B);
+  PROF_END();
+
+  // on cherche strictement mieux que la tournée initiale, à l'arrondi
+  // près si la borne de Held-Karp la prouve déjà optimale
+  if (lb < B.best * (1 - 1E-9)) {
+    PROF_BEGIN("tsp_bnb/search");
+    B.P[0] = 0, B.used[0] = true;
+    bnbExtend(&B, 0, 0);
+    PROF_END();
+  }
+
+  free(B.D);
+  free(B.pi);
+  free(B.E);
+  free(B.nbr);
+  free(B.P);
+  free(B.used);
+  free(B.parent);
+  free(B.height);
+  PROF_END();
+  return B.best;
+}
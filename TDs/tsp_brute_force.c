@@ -2,34 +2,37 @@
 //  TSP - BRUTE-FORCE
 //
 // -> la structure "point" est définie dans tools.h
+// -> les distances sont lues dans la matrice M (cf. tsp_dist.c)
 
 double dist(point A, point B) {
   return sqrt((A.x - B.x)*(A.x - B.x) + (A.y - B.y)*(A.y - B.y));
 }
 
-double value(point *V, int n, int *P) {
+double value(const distmat *M, int n, int *P) {
   double sum = 0;
   for(int i =0; i < n-1; i ++){
-    sum += dist(V[P[i]], V[P[i+1]]);
+    sum += distGet(M, P[i], P[i+1]);
   }
-  return sum + dist(V[P[n-1]], V[P[0]]);
+  return sum + distGet(M, P[n-1], P[0]);
 }
 
-double tsp_brute_force(point *V, int n, int *Q) {
+double tsp_brute_force(point *V, int n, int *Q, const distmat *M) {
+  PROF_BEGIN("tsp_brute_force");
   int P[n];
   for(int i = 0; i < n; i++){
     P[i] = i;
   }
   
-  double min = value(V, n, P);
+  double min = value(M, n, P);
   while(NextPermutation(P, n)){
-    if(min > value(V, n, P)){
-      min = value(V, n, P);
+    if(min > value(M, n, P)){
+      min = value(M, n, P);
       for(int i = 0; i < n; i ++){
         Q[i] = P[i];
       }
     }
   }
+  PROF_END();
   return min;
 }
 
@@ -38,35 +41,209 @@ void MaxPermutation(int *P, int n, int k) {
   return;
 }
 
-double value_opt(point *V, int n, int *P, double w) {
+double value_opt(const distmat *M, int n, int *P, double w) {
   double sum = 0;
   int i = 0;
-  while(sum += dist(V[P[i]], V[P[0]]) < w && i < n-1){
-    sum += dist(V[P[i]], V[P[i+1]]);
+  while(sum += distGet(M, P[i], P[0]) < w && i < n-1){
+    sum += distGet(M, P[i], P[i+1]);
     i ++;
   }
 
-  sum += dist(V[P[i]], V[P[0]]);
+  sum += distGet(M, P[i], P[0]);
   if(sum < w){
     return sum;
   }
   return -(i +1);
 }
 
-double tsp_brute_force_opt(point *V, int n, int *Q) {
+double tsp_brute_force_opt(point *V, int n, int *Q, const distmat *M) {
+  PROF_BEGIN("tsp_brute_force_opt");
   int P[n];
   for(int i = 0; i < n; i++){
     P[i] = i;
   }
   
-  double min = value(V, n, P);
+  double min = value(M, n, P);
   while(NextPermutation(P, n)){
-    if(value_opt(V, n, P, min) > 0){
-      min = value(V, n, P);
+    if(value_opt(M, n, P, min) > 0){
+      min = value(M, n, P);
       for(int i = 0; i < n; i ++){
         Q[i] = P[i];
       }
     }
   }
+  PROF_END();
   return min;
 }
+
+// Énumération exacte des (n-1)!/2 tournées distinctes: la ville 0 est
+// fixée en position 0 (rotations) et la ville en position 1 est plus
+// petite que celle en position n-1 (sens de parcours). On choisit donc
+// d'abord les extrémités a=P[1] < b=P[n-1], puis les positions 2..n-2
+// en profondeur. L[k] est la longueur du chemin P[0]..P[k], calculée à
+// partir de L[k-1]: une tournée coûte O(1) en moyenne (amorti sur les
+// préfixes communs) au lieu des O(n) de value().
+
+typedef struct {
+  int n;
+  int *P;      // tournée en construction
+  double *D;   // D[u*n+v] = dist(V[u],V[v])
+  double *L;   // L[k] = longueur du chemin P[0]..P[k]
+  double best; // longueur de la meilleure tournée
+  int *Q;      // meilleure tournée
+} bfstate;
+
+// Complète les positions k..n-2 avec les villes de P[k..n-2].
+static void bfExtend(bfstate *S, int k) {
+  const int n = S->n;
+  int *P = S->P, t;
+  const double *D = S->D;
+
+  if (k == n - 1) { // P[n-1] = b est déjà placée
+    const double w = S->L[n - 2] + D[P[n - 2] * n + P[n - 1]] + D[P[n - 1] * n];
+    if (w < S->best) {
+      S->best = w;
+      memcpy(S->Q, P, n * sizeof(int));
+    }
+    return;
+  }
+
+  for (int i = k; i < n - 1; i++) {
+    SWAP(P[k], P[i], t);
+    S->L[k] = S->L[k - 1] + D[P[k - 1] * n + P[k]];
+    bfExtend(S, k + 1);
+    SWAP(P[k], P[i], t);
+  }
+}
+
+double tsp_brute_force_inc(point *V, int n, int *Q, const distmat *M) {
+  PROF_BEGIN("tsp_brute_force_inc");
+  for (int i = 0; i < n; i++) Q[i] = i;
+  if (n <= 3) { // une seule tournée
+    PROF_END();
+    return value(M, n, Q);
+  }
+
+  int P[n];
+  double D[n * n], L[n];
+  for (int u = 0; u < n; u++)
+    for (int v = 0; v < n; v++) D[u * n + v] = distGet(M, u, v);
+  bfstate S = {n, P, D, L, DBL_MAX, Q};
+
+  P[0] = 0, L[0] = 0;
+  for (int a = 1; a < n && running; a++)
+    for (int b = a + 1; b < n; b++) {
+      P[1] = a, P[n - 1] = b;
+      for (int v = 1, k = 2; v < n; v++) // les autres villes au milieu
+        if (v != a && v != b) P[k++] = v;
+      L[1] = D[a];
+      bfExtend(&S, 2);
+    }
+
+  PROF_END();
+  return S.best;
+}
+
+// Version parallèle de l'énumération précédente, avec élagage: on
+// abandonne le préfixe P[0..k] dès que L[k] + d(P[k],b) + d(b,0), qui
+// minore toute tournée le prolongeant, atteint la meilleure longueur
+// connue. Le travail est découpé en préfixes (a,b,P[2]) indépendants,
+// distribués dynamiquement aux threads OpenMP, les préfixes les plus
+// courts en premier. La meilleure longueur est partagée (atomique) pour
+// que chaque thread élague avec la meilleure tournée de tous. La
+// tournée initiale est obtenue par flips. On s'arrête dès que running
+// passe à faux.
+
+double first_flip(const distmat *M, int n, int *P); // cf. tsp_approx.c
+
+typedef struct {
+  int n;
+  const double *D;    // D[u*n+v] = dist(V[u],V[v])
+  _Atomic double best; // longueur de la meilleure tournée
+  int *Q;             // meilleure tournée
+} bfshared;
+
+// Complète les positions k..n-2 de P, L[] étant comme dans bfExtend().
+static void bfPrune(bfshared *S, int *P, double *L, int k) {
+  const int n = S->n, b = P[n - 1];
+  const double *D = S->D;
+  int t;
+
+  if (k == n - 1) {
+    const double w = L[n - 2] + D[P[n - 2] * n + b] + D[b * n];
+    if (w < atomic_load_explicit(&S->best, memory_order_relaxed))
+      #pragma omp critical(bfshared)
+      if (w < atomic_load(&S->best)) {
+        atomic_store(&S->best, w);
+        memcpy(S->Q, P, n * sizeof(int));
+      }
+    return;
+  }
+  if (k < n - 4 && !running) return;
+
+  for (int i = k; i < n - 1; i++) {
+    SWAP(P[k], P[i], t);
+    L[k] = L[k - 1] + D[P[k - 1] * n + P[k]];
+    if (L[k] + D[P[k] * n + b] + D[b * n] <
+        atomic_load_explicit(&S->best, memory_order_relaxed))
+      bfPrune(S, P, L, k + 1);
+    SWAP(P[k], P[i], t);
+  }
+}
+
+// préfixe (a,b,c) de l'énumération parallèle et sa longueur minimale
+typedef struct {
+  int a, b, c;
+  double w;
+} bfprefix;
+
+static int compPrefix(const void *x, const void *y) {
+  const double a = ((bfprefix *)x)->w, b = ((bfprefix *)y)->w;
+  return (a > b) - (a < b);
+}
+
+double tsp_brute_force_par(point *V, int n, int *Q, const distmat *M) {
+  PROF_BEGIN("tsp_brute_force_par");
+  for (int i = 0; i < n; i++) Q[i] = i;
+  if (n <= 4) { // au plus 3 tournées
+    PROF_END();
+    return tsp_brute_force_inc(V, n, Q, M);
+  }
+
+  double *D = malloc(n * n * sizeof(*D));
+  for (int u = 0; u < n; u++)
+    for (int v = 0; v < n; v++) D[u * n + v] = distGet(M, u, v);
+  while (first_flip(M, n, Q) > 0) // tournée initiale
+    ;
+  bfshared S = {n, D, value(M, n, Q), Q};
+
+  // préfixes 0,a,c,...,b avec a < b
+  const int m = (n - 1) * (n - 2) / 2 * (n - 3);
+  bfprefix *T = malloc(m * sizeof(*T));
+  int k = 0;
+  for (int a = 1; a < n; a++)
+    for (int b = a + 1; b < n; b++)
+      for (int c = 1; c < n; c++)
+        if (c != a && c != b)
+          T[k++] = (bfprefix){a, b, c, D[a] + D[a * n + c] + D[c * n + b] + D[b]};
+  qsort(T, m, sizeof(*T), compPrefix);
+
+  #pragma omp parallel for schedule(dynamic)
+  for (int i = 0; i < m; i++) {
+    const bfprefix *p = T + i;
+    if (!running || p->w >= atomic_load_explicit(&S.best, memory_order_relaxed))
+      continue;
+    int P[n];
+    double L[n];
+    P[0] = 0, P[1] = p->a, P[2] = p->c, P[n - 1] = p->b;
+    for (int v = 1, j = 3; v < n; v++)
+      if (v != p->a && v != p->b && v != p->c) P[j++] = v;
+    L[0] = 0, L[1] = D[p->a], L[2] = L[1] + D[p->a * n + p->c];
+    bfPrune(&S, P, L, 3);
+  }
+
+  free(T);
+  free(D);
+  PROF_END();
+  return S.best;
+}
@@ -0,0 +1,107 @@
+//
+//  TSP - MATRICE DES DISTANCES
+//
+// Les distances entre les n points sont calculées une fois pour toutes
+// (sqrt() coûte bien plus qu'un accès mémoire) puis lues par tous les
+// algorithmes avec distGet(M,u,v). Comme d(u,v) = d(v,u), seul le
+// triangle u >= v est stocké, découpé en blocs de DIST_BLOCK x
+// DIST_BLOCK: le bloc (I,J), I >= J, contient les distances des points
+// I*DIST_BLOCK.. aux points J*DIST_BLOCK.., ligne par ligne. Les
+// distances d'un point à ses voisins d'indices proches sont ainsi dans
+// les mêmes lignes de cache, et chaque bloc se calcule par une boucle
+// vectorisée (cf. -fno-math-errno dans le Makefile) sur un thread
+// OpenMP.
+//
+// La matrice est en double ou en float (deux fois moins de mémoire, de
+// l'ordre de 1E-7 d'erreur relative). Si elle dépasse le budget mémoire
+// demandé, elle n'est pas stockée et distGet() calcule les distances à
+// la volée.
+
+#define DIST_BLOCK 16                 // côté d'un bloc (puissance de 2)
+#define DIST_BUDGET ((size_t)1 << 30) // budget mémoire par défaut (1 Go)
+
+typedef enum { DIST_DOUBLE, DIST_FLOAT } distprec;
+
+typedef struct {
+  int n;
+  point *V;  // les points, pour distUpdate() et le calcul à la volée
+  double *d; // matrice en double, ou NULL
+  float *f;  // matrice en float, ou NULL
+} distmat;
+
+// Position de d(u,v), u >= v, dans la matrice.
+static inline size_t distIndex(int u, int v) {
+  const size_t I = u / DIST_BLOCK, J = v / DIST_BLOCK;
+  return (I * (I + 1) / 2 + J) * DIST_BLOCK * DIST_BLOCK +
+         (u % DIST_BLOCK) * DIST_BLOCK + v % DIST_BLOCK;
+}
+
+// Distance de V[u] à V[v].
+static inline double distGet(const distmat *M, int u, int v) {
+  if (u < v) { const int t = u; u = v, v = t; }
+  if (M->d) return M->d[distIndex(u, v)];
+  if (M->f) return M->f[distIndex(u, v)];
+  const double x = M->V[u].x - M->V[v].x, y = M->V[u].y - M->V[v].y;
+  return sqrt(x * x + y * y);
+}
+
+// Nombre de cases de la matrice, blocs diagonaux complets compris.
+static size_t distSize(int n) {
+  const size_t m = (n + DIST_BLOCK - 1) / DIST_BLOCK;
+  return m * (m + 1) / 2 * DIST_BLOCK * DIST_BLOCK;
+}
+
+// (Re)calcule la matrice à partir des points M->V, par exemple après le
+// déplacement d'un point à la souris (cf. handleEvent()).
+void distUpdate(distmat *M) {
+  if (!M->d && !M->f) return; // calcul à la volée
+  PROF_BEGIN("distUpdate");
+  const int m = (M->n + DIST_BLOCK - 1) / DIST_BLOCK, N = m * DIST_BLOCK;
+
+  // coordonnées contiguës, complétées par des 0 jusqu'à un bloc entier
+  double *X = calloc(2 * N, sizeof(*X)), *Y = X + N;
+  for (int u = 0; u < M->n; u++) X[u] = M->V[u].x, Y[u] = M->V[u].y;
+
+  #pragma omp parallel for schedule(dynamic)
+  for (int I = 0; I < m; I++)
+    for (int J = 0; J <= I; J++) {
+      const size_t b = distIndex(I * DIST_BLOCK, J * DIST_BLOCK);
+      const double *x = X + J * DIST_BLOCK, *y = Y + J * DIST_BLOCK;
+      for (int i = 0; i < DIST_BLOCK; i++) {
+        const double xu = X[I * DIST_BLOCK + i], yu = Y[I * DIST_BLOCK + i];
+        const size_t r = b + i * DIST_BLOCK;
+        if (M->d) {
+          double *restrict d = M->d + r;
+          for (int j = 0; j < DIST_BLOCK; j++)
+            d[j] = sqrt((xu - x[j]) * (xu - x[j]) + (yu - y[j]) * (yu - y[j]));
+        } else {
+          float *restrict f = M->f + r;
+          for (int j = 0; j < DIST_BLOCK; j++)
+            f[j] = sqrtf((float)((xu - x[j]) * (xu - x[j]) +
+                                 (yu - y[j]) * (yu - y[j])));
+        }
+      }
+    }
+
+  free(X);
+  PROF_END();
+}
+
+// Matrice des distances des n points de V, en précision p si elle tient
+// dans budget octets (0 pour DIST_BUDGET), sinon à la volée. Les points
+// ne sont pas copiés: V doit rester alloué tant que M est utilisée.
+distmat distCreate(point *V, int n, distprec p, size_t budget) {
+  distmat M = {n, V, NULL, NULL};
+  const size_t s = distSize(n) * (p == DIST_FLOAT ? sizeof(float) : sizeof(double));
+  if (s > (budget ? budget : DIST_BUDGET)) return M;
+  if (p == DIST_FLOAT) M.f = malloc(s);
+  else M.d = malloc(s);
+  distUpdate(&M);
+  return M;
+}
+
+void distFree(distmat *M) {
+  free(M->d);
+  free(M->f);
+  M->d = NULL, M->f = NULL;
+}
@@ -1,20 +1,25 @@
 #include "tools.h"
 
+#include "tsp_dist.c"
 #include "tsp_brute_force.c"
 #include "tsp_prog_dyn.c"
 #include "tsp_approx.c"
 #include "tsp_mst.c"
+#include "tsp_bnb.c"
+#include "tsp_cluster.c"
 
 int main(int argc, char *argv[]) {
 
   unsigned seed = time(NULL) % 1000;
   printf("seed: %u\n", seed); // pour rejouer la même chose au cas où
-  srandom(seed);
-  TopChrono(0); // initialise tous les chronos
+  rng R; // générateur aléatoire des points (cf. rng.h)
+  rngSeed(&R, seed);
+  PROF_EXIT("tsp.json"); // avec make PROF=1, cf. prof.h
 
   const int n = (argv[1] && atoi(argv[1])) ? atoi(argv[1]) : 10;
-  point *V = generatePoints(n); // n points au hasard
-  //point *V = generateCircles(n,3); // n points sur k=2 cercles au hasard
+  point *V = generatePoints(n, &R); // n points au hasard
+  //point *V = generateCircles(n,3,&R); // n points sur k=2 cercles au hasard
+  distmat M = distCreate(V, n, DIST_DOUBLE, 0); // distances (cf. tsp_dist.c)
   int *P = malloc(n * sizeof(int)); // P = la tournée
   P[0] = -1; // permutation qui ne sera pas dessinée par drawTour()
 
@@ -26,9 +31,9 @@ int main(int argc, char *argv[]) {
   // brute-force -> FAIT
   /*
   {
-    TopChrono(1); // départ du chrono 1
-    printf("value: %g\n", tsp_brute_force(V, n, P));
-    printf("running time: %s\n", TopChrono(1)); // durée
+    const uint64_t t0 = profNow(); // départ du chrono
+    printf("value: %g\n", tsp_brute_force(V, n, P, &M));
+    printf("running time: %.3lfs\n", 1E-9 * (profNow() - t0)); // durée
     update = true; // force l'affichage
     while (running) { // affiche le résultat et attend (q pour sortir)
       drawTour(V, n, P);  // dessine la tournée
@@ -41,9 +46,65 @@ int main(int argc, char *argv[]) {
   // brute-force optimisé -> SEGFAULT
   /*
   {
-    TopChrono(1); // départ du chrono 1
-    printf("value: %g\n", tsp_brute_force_opt(V, n, P));
-    printf("running time: %s\n", TopChrono(1)); // durée
+    const uint64_t t0 = profNow(); // départ du chrono
+    printf("value: %g\n", tsp_brute_force_opt(V, n, P, &M));
+    printf("running time: %.3lfs\n", 1E-9 * (profNow() - t0)); // durée
+    update = true; // force l'affichage
+    while (running) { // affiche le résultat et attend (q pour sortir)
+      drawTour(V, n, P);  // dessine la tournée
+      handleEvent(update); // attend un évènement ou pas
+    }
+  }
+  */
+
+  // brute-force incrémental, (n-1)!/2 tournées
+  /*
+  {
+    const uint64_t t0 = profNow(); // départ du chrono
+    printf("value: %g\n", tsp_brute_force_inc(V, n, P, &M));
+    printf("running time: %.3lfs\n", 1E-9 * (profNow() - t0)); // durée
+    update = true; // force l'affichage
+    while (running) { // affiche le résultat et attend (q pour sortir)
+      drawTour(V, n, P);  // dessine la tournée
+      handleEvent(update); // attend un évènement ou pas
+    }
+  }
+  */
+
+  // brute-force parallèle avec élagage (OMP_NUM_THREADS threads)
+  /*
+  {
+    const uint64_t t0 = profNow(); // départ du chrono
+    printf("value: %g\n", tsp_brute_force_par(V, n, P, &M));
+    printf("running time: %.3lfs\n", 1E-9 * (profNow() - t0)); // durée
+    update = true; // force l'affichage
+    while (running) { // affiche le résultat et attend (q pour sortir)
+      drawTour(V, n, P);  // dessine la tournée
+      handleEvent(update); // attend un évènement ou pas
+    }
+  }
+  */
+
+  // branch-and-bound, exact jusqu'à n=60 environ
+  /*
+  {
+    const uint64_t t0 = profNow(); // départ du chrono
+    printf("value: %g\n", tsp_bnb(V, n, P, &M));
+    printf("running time: %.3lfs\n", 1E-9 * (profNow() - t0)); // durée
+    update = true; // force l'affichage
+    while (running) { // affiche le résultat et attend (q pour sortir)
+      drawTour(V, n, P);  // dessine la tournée
+      handleEvent(update); // attend un évènement ou pas
+    }
+  }
+  */
+
+  // paquets puis tournée, quasi-optimal jusqu'à n=40 environ
+  /*
+  {
+    const uint64_t t0 = profNow(); // départ du chrono
+    printf("value: %g\n", tsp_cluster(V, n, P, &M));
+    printf("running time: %.3lfs\n", 1E-9 * (profNow() - t0)); // durée
     update = true; // force l'affichage
     while (running) { // affiche le résultat et attend (q pour sortir)
       drawTour(V, n, P);  // dessine la tournée
@@ -55,9 +116,9 @@ int main(int argc, char *argv[]) {
   // programmation dynamique -> PAS FAIT
 /*
   {
-    TopChrono(1); // départ du chrono 1
-    printf("value: %g\n", tsp_prog_dyn(V, n, P));
-    printf("running time: %s\n", TopChrono(1)); // durée
+    const uint64_t t0 = profNow(); // départ du chrono
+    printf("value: %g\n", tsp_prog_dyn(V, n, P, &M));
+    printf("running time: %.3lfs\n", 1E-9 * (profNow() - t0)); // durée
     update = true; // force l'affichage
     while (running) { // affiche le résultat et attend (q pour sortir)
       drawTour(V, n, P);  // dessine la tournée
@@ -66,19 +127,33 @@ int main(int argc, char *argv[]) {
   }
 */
 
+  // programmation dynamique compacte, jusqu'à n=30 selon la mémoire
+  /*
+  {
+    const uint64_t t0 = profNow(); // départ du chrono
+    printf("value: %g\n", tsp_prog_dyn_compact(V, n, P, &M));
+    printf("running time: %.3lfs\n", 1E-9 * (profNow() - t0)); // durée
+    update = true; // force l'affichage
+    while (running) { // affiche le résultat et attend (q pour sortir)
+      drawTour(V, n, P);  // dessine la tournée
+      handleEvent(update); // attend un évènement ou pas
+    }
+  }
+  */
+
   // flip -> FAIT
 /*
   {
-    TopChrono(1);         // départ du chrono 1
-    printf("value: %g\n", tsp_flip(V, n, P));
-    printf("running time: %s\n", TopChrono(1)); // durée
+    const uint64_t t0 = profNow();         // départ du chrono
+    printf("value: %g\n", tsp_flip(V, n, P, &M));
+    printf("running time: %.3lfs\n", 1E-9 * (profNow() - t0)); // durée
 
     while (running) { // affiche le résultat et attend (q pour sortir)
       update = true; // force l'affichage
-      if (first_flip(V, n, P)>0)
+      if (first_flip(&M, n, P)>0)
 	      update = false;
       drawTour(V, n, P);  // dessine la tournée
-      handleEvent(update); // attend un évènement ou pas
+      if (handleEvent(update)) distUpdate(&M); // un point a bougé
     }
   }
 */
@@ -86,15 +161,15 @@ int main(int argc, char *argv[]) {
   // greedy -> PAS FAIT
   /*
   {
-    TopChrono(1);         // départ du chrono 1
-    printf("value: %g\n", tsp_greedy(V, n, P));
-    printf("running time: %s\n", TopChrono(1)); // durée
+    const uint64_t t0 = profNow();         // départ du chrono
+    printf("value: %g\n", tsp_greedy(V, n, P, &M));
+    printf("running time: %.3lfs\n", 1E-9 * (profNow() - t0)); // durée
     while (running) { // affiche le résultat et attend (q pour sortir)
       update = true; // force l'affichage
-      if (first_flip(V, n, P)>0)
+      if (first_flip(&M, n, P)>0)
 	      update = false;
       drawTour(V, n, P);  // dessine la tournée
-      handleEvent(update); // attend un évènement ou pas
+      if (handleEvent(update)) distUpdate(&M); // un point a bougé
     }
   }
   */
@@ -102,15 +177,15 @@ int main(int argc, char *argv[]) {
   // mst -> FAIT
   
   {
-    TopChrono(1);         // départ du chrono 1
+    const uint64_t t0 = profNow();         // départ du chrono
     graph T=createGraph(n); // graphe vide
-    printf("value: %g\n", tsp_mst(V,n,P,T));
-    printf("running time: %s\n", TopChrono(1)); // durée
+    printf("value: %g\n", tsp_mst(V,n,P,T,&M));
+    printf("running time: %.3lfs\n", 1E-9 * (profNow() - t0)); // durée
     bool new_redraw = true;
     while(running){
       update = true;
-      if (new_redraw) tsp_mst(V,n,P,T);
-      if (first_flip(V,n,P)>0) update = false;
+      if (new_redraw) distUpdate(&M), tsp_mst(V,n,P,T,&M);
+      if (first_flip(&M,n,P)>0) update = false;
       drawGraph(V,n,P,T); // mettre P = NULL pour n'afficher que l'arbre
       new_redraw = handleEvent(update);
     }
@@ -118,7 +193,7 @@ int main(int argc, char *argv[]) {
   }
 
   // Libération de la mémoire
-  TopChrono(-1);
+  distFree(&M);
   free(V);
   free(P);
 
@@ -81,7 +81,7 @@ void dfs(graph G, int u, int *Q, int p) {
       dfs(G, G.list[u][i], Q, u);
 }
 
-double tsp_mst(point *V, int n, int *Q, graph T) {
+double tsp_mst(point *V, int n, int *Q, graph T, const distmat *M) {
   // Cette fonction à compléter doit calculer trois choses (=les
   // sorties) à partir de V et n (=les entrées):
   //
@@ -102,6 +102,8 @@ double tsp_mst(point *V, int n, int *Q, graph T) {
 
   // E = tableau de toutes les arêtes définies à partir des n points de V
 
+  PROF_BEGIN("tsp_mst");
+  PROF_BEGIN("tsp_mst/aretes");
   int m = n * (n-1) / 2;
 
   edge *E = malloc(m * sizeof(edge));
@@ -115,7 +117,7 @@ double tsp_mst(point *V, int n, int *Q, graph T) {
       edge e;
       e.u = i;
       e.v = j;
-      e.weight = dist(V[e.u], V[e.v]);
+      e.weight = distGet(M, e.u, e.v);
       
       // On ajoute l'arête au tableau
       E[eindex] = e;
@@ -123,8 +125,13 @@ double tsp_mst(point *V, int n, int *Q, graph T) {
     }
   }
 
+  PROF_END();
+
+  PROF_BEGIN("tsp_mst/tri");
   qsort(E, m, sizeof(edge), compEdge);
+  PROF_END();
 
+  PROF_BEGIN("tsp_mst/kruskal");
   // initialisation pour Union-and-Find
   int *parent = malloc(n * sizeof(int)); // parent[x]=parent de x (=x si racine)
   int *height = malloc(n * sizeof(int)); // height[x]=hauteur de l'arbre de racine x
@@ -160,6 +167,7 @@ double tsp_mst(point *V, int n, int *Q, graph T) {
     
     i++;
   }
+  PROF_END();
 
   // printf("pas segfault\n");
 
@@ -168,6 +176,9 @@ double tsp_mst(point *V, int n, int *Q, graph T) {
   free(height);
   free(E);
 
+  PROF_BEGIN("tsp_mst/dfs");
   dfs(T, 0, Q, -1);      // calcule Q grâce au DFS à partir du sommet 0 de T
-  return value(V, n, Q); // renvoie la valeur de la tournée
+  PROF_END();
+  PROF_END();
+  return value(M, n, Q); // renvoie la valeur de la tournée
 }
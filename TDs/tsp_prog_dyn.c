@@ -79,7 +79,7 @@ int ExtractPath(cell **D, int t, int S, int n, int *Q) {
   return k;
 }
 
-double tsp_prog_dyn(point *V, int n, int *Q) {
+double tsp_prog_dyn(point *V, int n, int *Q, const distmat *M) {
   /*
     Version programmation dynamique du TSP. Le résultat (la tournée
     optimale) doit être écrit dans la permutation Q, tableau qui doit
@@ -112,6 +112,7 @@ double tsp_prog_dyn(point *V, int n, int *Q) {
           de mémoire.
   */
 
+  PROF_BEGIN("tsp_prog_dyn");
   int t, S, K;
 
   // déclaration de la table D[t][S] qui comportent (n-1)*2^(n-1) cellules
@@ -123,7 +124,7 @@ double tsp_prog_dyn(point *V, int n, int *Q) {
   S = 1; // S=00...001 et pour l'incrémenter utiliser NextSet(S,n-1)
   
   for(t = 0; t < n-1; t++){
-      D[t][S].length = dist(V[n-1], V[t]);
+      D[t][S].length = distGet(M, n-1, t);
       D[t][S].pred = n-1;
       NextSet(S, n);
   }
@@ -132,6 +133,7 @@ double tsp_prog_dyn(point *V, int n, int *Q) {
   // d(V[x],V[t]) } avec t dans S et x dans S\{t}. NB: pour faire T =
   // S\{t}, utilisez T=DeleteSet(S,t); et pour savoir si x appartient
   // à l'ensemble S testez tout simplement si (S != DeleteSet(S,x)).
+  PROF_BEGIN("tsp_prog_dyn/table");
   do {
 
     for(int t = 0; t < n - 1; t ++){
@@ -140,10 +142,11 @@ double tsp_prog_dyn(point *V, int n, int *Q) {
 
       if(S != DeleteSet(S, t)){ // si t appartient à S, alors on entre dedans
 
+        int T = DeleteSet(S,t); // T = S\{t}
         for(int x = 0; x < n - 1; x ++){
-          int T = DeleteSet(S,t); // T = S\{t}
-          if(min > D[x][T].length + dist(V[x], V[t])){
-            min = D[x][T].length + dist(V[x], V[t]);
+          const double w = D[x][T].length + distGet(M, x, t);
+          if(min > w){
+            min = w;
             pred = x;
           }
         }
@@ -165,6 +168,7 @@ double tsp_prog_dyn(point *V, int n, int *Q) {
     K = S;
     S = NextSet(S, n - 1);
   } while (S && running);
+  PROF_END();
 
   double w = 0; // valeur de la tournée optimale, 0 par défaut
 
@@ -175,7 +179,7 @@ double tsp_prog_dyn(point *V, int n, int *Q) {
     // si le calcul a été interrompu (pression de 'q' pendant
     // l'affichage) alors ne rien faire et renvoyer 0
     for(t = 0; t < n - 1; t ++){
-      w = fmin(w, fmin(D[t][K].length, dist(V[t], V[n - 1])));
+      w = fmin(w, fmin(D[t][K].length, distGet(M, t, n - 1)));
     } 
   }
 
@@ -184,6 +188,192 @@ double tsp_prog_dyn(point *V, int n, int *Q) {
   }
   free(D);
 
+  PROF_END();
+  return w;
+}
+
+// Version compacte de tsp_prog_dyn(), même récurrence, même
+// convention (chemins partant de V[n-1]), mais:
+//
+// - les ensembles S sont des masques sur 64 bits (n <= 64);
+//
+// - la table est rangée par couches: la couche k contient, pour chaque
+//   ensemble S de taille k et chaque t de S, la longueur D[t][S].
+//   L'ordre des S dans une couche est celui de NextSet64(), et S est
+//   repéré par son rang dans cet ordre: rang(S) = somme des
+//   binomial(b_i,i+1) où b_0 < b_1 < ... sont les éléments de S. Seules
+//   les k*binomial(n-1,k) cases utiles sont donc stockées, au lieu de
+//   2^(n-1) par t;
+//
+// - les longueurs sont des float et seules deux couches sont gardées
+//   (la couche k ne dépend que de la couche k-1), les prédécesseurs
+//   sont des uint8_t, gardés pour toutes les couches afin de
+//   reconstruire la tournée.
+//
+// Soit (n-1)*2^(n-2) octets de prédécesseurs plus deux couches de
+// float, contre (n-1)*2^(n-1)*sizeof(cell) pour tsp_prog_dyn(): 17 Go
+// au lieu de 250 Go pour n=30.
+//
+// Chaque couche ne dépendant que de la précédente, elle est calculée en
+// parallèle: découpée en tranches de HK_CHUNK ensembles consécutifs
+// (rang r0 à r0+HK_CHUNK-1, le premier obtenu par unrankSet()),
+// distribuées aux threads OpenMP. La table étant rangée par ensemble, le
+// minimum sur x de D[x][T] + d(x,t) parcourt les D[x][T] d'un même T,
+// contigus, et la ligne de t de la matrice des distances locale d[].
+// Vectoriser ce minimum n'est pas rentable: il porte sur |T| < 30
+// valeurs et il faut aussi le x qui le réalise.
+
+#define HK_CHUNK 1024 // ensembles par tâche
+
+// Comme NextSet(), sur 64 bits.
+uint64_t NextSet64(uint64_t S, int n) {
+  int p1 = __builtin_ffsll(S);
+  int p2 = __builtin_ffsll(~(S >> p1)) + p1 - 1;
+  if (p2 - p1 + 1 == n)
+    return 0;
+  if (p2 == n)
+    return ((uint64_t)1 << (p2 - p1 + 2)) - 1;
+  return (S & (~(uint64_t)0 << p2)) | ((uint64_t)1 << p2) |
+         (((uint64_t)1 << (p2 - p1)) - 1);
+}
+
+// binomial[a][b] = b parmi a, pour a,b < 64
+static uint64_t binomial[64][64];
+
+static void initBinomial(void) {
+  for (int a = 0; a < 64; a++)
+    for (int b = 0; b < 64; b++)
+      binomial[a][b] = (b == 0) ? 1 : (a == 0) ? 0 : binomial[a - 1][b - 1] + binomial[a - 1][b];
+}
+
+// Rang de S parmi les ensembles de même taille, et position de t dans S.
+static size_t rankSet(uint64_t S, int t, int *j) {
+  size_t r = 0;
+  for (int i = 0; S; S &= S - 1, i++) {
+    const int b = __builtin_ctzll(S);
+    if (b == t) *j = i;
+    r += binomial[b][i + 1];
+  }
+  return r;
+}
+
+// Ensemble de rang r parmi ceux de taille k sur 0..N-1 (l'inverse de
+// rankSet()): on prend le plus grand b avec binomial(b,k) <= r, puis on
+// recommence avec r-binomial(b,k) et k-1 en dessous de b.
+static uint64_t unrankSet(size_t r, int k, int N) {
+  uint64_t S = 0;
+  for (int b = N - 1; k > 0; k--, b--) {
+    while (binomial[b][k] > r) b--;
+    r -= binomial[b][k];
+    S |= (uint64_t)1 << b;
+  }
+  return S;
+}
+
+// Écrit dans Q[0..k] le chemin de V[n-1] à V[t] qui visite S (|S|=k)
+// en partant de la fin, grâce aux prédécesseurs P[] des couches.
+static void extractPathCompact(uint8_t **P, uint64_t S, int t, int k, int n, int *Q) {
+  for (int j = 0; k > 1; k--) {
+    const size_t r = rankSet(S, t, &j);
+    Q[k] = t;
+    S &= ~((uint64_t)1 << t);
+    t = P[k][r * k + j];
+  }
+  Q[1] = t;
+  Q[0] = n - 1;
+}
+
+double tsp_prog_dyn_compact(point *V, int n, int *Q, const distmat *M) {
+  PROF_BEGIN("tsp_prog_dyn_compact");
+  const int N = n - 1; // les ensembles sont sur 0..N-1
+  for (int i = 0; i < n; i++) Q[i] = i;
+  if (n <= 3 || n > 64) {
+    PROF_END();
+    return (n <= 3) ? value(M, n, Q) : -1;
+  }
+  initBinomial();
+
+  float d[n * n]; // d[u*n+v] = dist(V[u],V[v])
+  for (int u = 0; u < n; u++)
+    for (int v = 0; v < n; v++) d[u * n + v] = distGet(M, u, v);
+
+  // deux couches de longueurs, de la taille de la plus grande
+  size_t m = 0;
+  for (int k = 1; k <= N; k++)
+    if (k * binomial[N][k] > m) m = k * binomial[N][k];
+  float *prev = malloc(m * sizeof(float)), *cur = malloc(m * sizeof(float));
+  uint8_t **P = calloc(N + 1, sizeof(uint8_t *)); // P[k] = prédécesseurs de la couche k
+  bool ok = prev && cur && P;
+
+  // couche 1: D[t][{t}] = d(V[n-1],V[t]), et rang({t}) = t
+  if (ok)
+    for (int t = 0; t < N; t++) prev[t] = d[(n - 1) * n + t];
+
+  PROF_BEGIN("tsp_prog_dyn_compact/table");
+  for (int k = 2; k <= N && ok && running; k++) {
+    const size_t c = binomial[N][k];
+    uint8_t *Pk = P[k] = malloc(k * c);
+    if (!(ok = Pk)) break;
+    float best = FLT_MAX;
+    uint64_t bestS = 0;
+    int bestT = 0;
+
+    // tranches de HK_CHUNK ensembles consécutifs, une par tâche
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t q = 0; q < (c + HK_CHUNK - 1) / HK_CHUNK; q++) {
+      const size_t r1 = (q + 1) * HK_CHUNK < c ? (q + 1) * HK_CHUNK : c;
+      float qbest = FLT_MAX;
+      uint64_t qS = 0;
+      int qT = 0;
+      int b[k];                  // éléments de S
+      size_t pre[k], suf[k + 1]; // rang(S\{b_j}) = pre[j] + suf[j+1]
+
+      uint64_t S = unrankSet(q * HK_CHUNK, k, N);
+      for (size_t r = q * HK_CHUNK; r < r1; r++, S = NextSet64(S, N)) {
+        uint64_t T = S;
+        for (int i = 0; i < k; i++, T &= T - 1) b[i] = __builtin_ctzll(T);
+        pre[0] = 0, suf[k] = 0;
+        for (int i = 1; i < k; i++) pre[i] = pre[i - 1] + binomial[b[i - 1]][i];
+        for (int i = k - 1; i > 0; i--) suf[i] = suf[i + 1] + binomial[b[i]][i];
+        for (int j = 0; j < k; j++) { // t = b[j], x dans T = S\{t}
+          // L[i] = D[x][T] pour x = b[i] si i < j, x = b[i+1] sinon
+          const float *L = prev + (pre[j] + suf[j + 1]) * (k - 1), *dt = d + b[j] * n;
+          float w = FLT_MAX;
+          int x = 0;
+          for (int i = 0; i < k - 1; i++) {
+            const int y = b[i + (i >= j)];
+            if (L[i] + dt[y] < w) w = L[i] + dt[y], x = y;
+          }
+          cur[r * k + j] = w;
+          Pk[r * k + j] = x;
+          if (w < qbest) qbest = w, qS = S, qT = b[j];
+        }
+      }
+
+      #pragma omp critical(hkbest)
+      if (qbest < best) best = qbest, bestS = qS, bestT = qT;
+    }
+
+    float *t = prev;
+    prev = cur, cur = t;
+    extractPathCompact(P, bestS, bestT, k, n, Q); // meilleur chemin de la couche
+    drawPath(V, n, Q, k + 1);
+  }
+  PROF_END();
+
+  double w = -1; // interrompu ou mémoire insuffisante
+  if (ok && running) { // couche N: un seul ensemble, rang 0
+    int t = 0;
+    for (int j = 0; j < N; j++)
+      if (prev[j] + d[j * n + n - 1] < prev[t] + d[t * n + n - 1]) t = j;
+    extractPathCompact(P, ((uint64_t)1 << N) - 1, t, N, n, Q);
+    w = value(M, n, Q);
+  }
 
+  for (int k = 0; P && k <= N; k++) free(P[k]);
+  free(P);
+  free(prev);
+  free(cur);
+  PROF_END();
   return w;
 }
@@ -4,9 +4,6 @@
 #include "tp.h"
 
 
-#define RAND01  ((double)random()/(double)RAND_MAX) /* réel aléatoire dans [0,1[ */
-
-
 inline double dist(point A, point B){
   return hypot(B.x-A.x,B.y-A.y);
 }
@@ -35,12 +32,17 @@ point *read(char *file, int *n){
 }
 
 
-point *point_random(int n){
+point *point_random_rng(int n, rng *R){
   if(n<1) return NULL;
   point *P=malloc(n*sizeof(*P));
-  for(int i=0;i<n;i++){
-    P[i].x=RAND01;
-    P[i].y=RAND01;
-  }
+  rngFill(R,&P[0].x,2*n); // un point = deux double consécutifs
   return P;
 }
+
+
+// la graine vient de random(), srandom() suffit donc à rejouer un tirage
+point *point_random(int n){
+  rng R;
+  rngSeed(&R,random());
+  return point_random_rng(n,&R);
+}
@@ -22,6 +22,7 @@
 #include <time.h>
 #include <math.h>
 #include "tp.h"
+#include "../TDs/prof.h"
 
 
 // fonction de comparaison (à completer ...) des ordonnées de deux
@@ -95,6 +96,7 @@ paire rec(point *Px, point *Py, int n)
   if(n == 2 || n == 3) return algo_naif(Px, n);
   // Ce cas ne devrait jamais arriver, mais au moins on a l'info si on a un bug bizarre
   if(n < 2) printf("[rec/ERROR] n should not be lower than 2 (val=%i).\n", n);
+  PROF_BEGIN("rec");
 
   // Il nous faut le point médian de Px, c'est à dire le point au milieu du tableau Px
   const point median = Px[n / 2];
@@ -202,6 +204,7 @@ paire rec(point *Px, point *Py, int n)
 
   // On n'a plus besoin de Sy, donc on le lib_ère
   free(Sy);
+  PROF_END();
 
   // On arrive au bout! On a:
   // - (s, s'): la paire qu'on vient de calculer
@@ -222,6 +225,8 @@ paire rec(point *Px, point *Py, int n)
 // on suppose que P contient au moins n>=2 points
 paire algo_rec(point *P, int n)
 {
+  PROF_BEGIN("algo_rec");
+  PROF_BEGIN("algo_rec/tri");
   // On créé les tableaux Px et Py
   point *Px = malloc(n * sizeof(*Px));
   point *Py = malloc(n * sizeof(*Py));
@@ -236,6 +241,7 @@ paire algo_rec(point *P, int n)
   // On les trie
   qsort(Px, n, sizeof(point), fcmp_x);
   qsort(Py, n, sizeof(point), fcmp_y);
+  PROF_END();
 
   // On peut désormais utiliser l'algo recursif
   paire resultat = rec(Px, Py, n);
@@ -244,6 +250,7 @@ paire algo_rec(point *P, int n)
   free(Px);
   free(Py);
 
+  PROF_END();
   return resultat;
 }
 
@@ -251,6 +258,7 @@ paire algo_rec(point *P, int n)
 int main(int argc, char *argv[]){
   
   srandom(time(NULL));
+  PROF_EXIT("tp.json"); // avec make PROF=1, cf. ../TDs/prof.h
 
   if(argc==2){
     //
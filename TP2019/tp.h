@@ -1,5 +1,6 @@
 #ifndef TP_H
 #define TP_H
+#include "../TDs/rng.h"
 
 #define FORM "%.08lf" // format d'affichage d'une coordonnées
 
@@ -25,4 +26,7 @@ extern point *read(char *file, int *n);
 // génère un ensemble de n points aléatoires à coordonnées dans [0,1[
 extern point *point_random(int n);
 
+// idem avec le générateur R, le tirage ne dépend que de son état
+extern point *point_random_rng(int n, rng *R);
+
 #endif